@@ -3,6 +3,7 @@
 #include <iostream>
 #include <sstream>
 #include <random>
+#include <algorithm>
 
 #include "../utils/tools.h"
 #include "../include/constants.h"
@@ -10,35 +11,68 @@
 namespace raft {
 
 // 构造函数
-RaftCore::RaftCore(int node_id, int cluster_size, LogStore* log_store, KVStore* kv_store)
+RaftCore::RaftCore(int node_id, int cluster_size, LogStore* log_store, KVStore* kv_store, SnapshotStore* snapshot_store,
+                   int group_id)
     : id_(node_id), 
       cluster_size_(cluster_size), 
+      group_id_(group_id),
       log_store_(log_store), 
       kv_store_(kv_store),
+      snapshot_store_(snapshot_store),
       state_(NodeState::FOLLOWER),
       current_term_(0),
       voted_(false),
+      voted_for_(0),
       vote_count_(0),
       leader_id_(0),
-      received_heartbeat_(false),
+      leader_term_(0),
+      pre_vote_term_(0),
+      pre_vote_count_(0),
       commit_index_(0),
       last_applied_(0),
       leader_commit_index_(0),
       ack_(0),
       response_node_count_(0),
       seq_(0),
-      live_count_(0),
+      noop_index_(0),
       running_(false) {
     
     // 初始化Leader状态数据
     match_index_.resize(cluster_size_ - 1, 0);
     match_term_.resize(cluster_size_ - 1, 0);
+    next_index_.resize(cluster_size_ - 1, 1);
+    inflight_.resize(cluster_size_ - 1, 0);
+    last_sent_seq_.resize(cluster_size_ - 1, -1);
+    acked_seq_.resize(cluster_size_ - 1, -1);
+    last_response_time_.resize(cluster_size_ - 1);
+    last_contact_time_.resize(cluster_size_ - 1);
+    retry_after_.resize(cluster_size_ - 1);
+
+    // 从存储恢复任期、投票和提交索引（快照覆盖的日志必然已提交）
+    int term = 0;
+    int voted_for = 0;
+    int commit = 0;
+    log_store_->load_hard_state(term, voted_for, commit);
+    current_term_ = term;
+    voted_for_ = voted_for;
+    voted_ = voted_for != 0;
+    int snapshot_index = log_store_->snapshot_index();
+    commit_index_ = std::max(snapshot_index, std::min(commit, log_store_->latest_index()));
+    last_applied_ = snapshot_index;
+    log_store_->commit(commit_index_);
+
+    // 本地日志持久化后，leader可能凑够多数派，follower可以确认等待持久化的AppendEntries
+    log_store_->set_durable_callback([this](int) {
+        updateCommitIndex();
+        sendDurableAcks();
+    });
 }
 
 // 析构函数
 RaftCore::~RaftCore() {
     // 确保停止所有线程
     stop();
+    log_store_->set_durable_callback(nullptr);
 }
 
 // 启动Raft服务
@@ -48,9 +82,15 @@ void RaftCore::start() {
     }
     
     running_ = true;
+    resetElectionTimer();
     
     // 启动主循环线程
     main_loop_thread_ = std::thread(&RaftCore::mainLoop, this);
+
+    // 为每个follower启动复制线程（非leader时空闲）
+    for (int peer_id : getPeerNodeIds()) {
+        replicator_threads_.emplace_back(&RaftCore::replicatorLoop, this, peer_id);
+    }
     
     // 不再启动日志应用线程，该功能已移至RaftNode
     // log_applier_thread_ = std::thread(&RaftCore::logApplierLoop, this);
@@ -65,6 +105,10 @@ void RaftCore::stop() {
     }
     
     running_ = false;
+    failCommitWaiters();
+    failReads();
+    dropPendingAcks(0);
+    notifyTimer();
     
     // 唤醒可能在等待的条件变量
     {
@@ -76,6 +120,15 @@ void RaftCore::stop() {
     if (main_loop_thread_.joinable()) {
         main_loop_thread_.join();
     }
+
+    // 等待复制线程结束
+    notifyReplicators();
+    for (auto& thread : replicator_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    replicator_threads_.clear();
     
     // 不再需要等待日志应用线程，该功能已移至RaftNode
     // if (log_applier_thread_.joinable()) {
@@ -128,6 +181,29 @@ std::unique_ptr<Message> RaftCore::handleMessage(int from_node_id, const Message
             handleAppendEntriesResponse(from_node_id, response);
             return nullptr;
         }
+
+        case MessageType::INSTALLSNAPSHOT_REQUEST: {
+            const auto& request = static_cast<const InstallSnapshotRequest&>(message);
+            return handleInstallSnapshot(from_node_id, request);
+        }
+
+        case MessageType::INSTALLSNAPSHOT_RESPONSE: {
+            const auto& response = static_cast<const InstallSnapshotResponse&>(message);
+            handleInstallSnapshotResponse(from_node_id, response);
+            return nullptr;
+        }
+
+        case MessageType::READINDEX_REQUEST: {
+            const auto& request = static_cast<const ReadIndexRequest&>(message);
+            handleReadIndexRequest(from_node_id, request);
+            return nullptr;
+        }
+
+        case MessageType::READINDEX_RESPONSE: {
+            const auto& response = static_cast<const ReadIndexResponse&>(message);
+            handleReadIndexResponse(from_node_id, response);
+            return nullptr;
+        }
             
         default://理论不会到这一步
             std::cerr << "[RaftCore:] " << "Unknown message type: " << static_cast<int>(message.getType()) << std::endl;
@@ -137,28 +213,350 @@ std::unique_ptr<Message> RaftCore::handleMessage(int from_node_id, const Message
 
 // 添加日志条目
 int RaftCore::appendLogEntry(const std::string& command, int term) {
-    log_store_->append(command, term);
-    return log_store_->latest_index();
+    int index = 0;
+    {
+        // 与follower追加、降级持同一组锁：降级或任期变化后不能再以旧任期的leader身份写入日志
+        std::lock_guard<std::mutex> append_lock(append_entries_mutex_);
+        std::lock_guard<std::mutex> vote_lock(vote_mutex_);
+        if (!running_ || state_ != NodeState::LEADER || current_term_ != term) {
+            return 0;
+        }
+        log_store_->append(command, term);
+        index = log_store_->latest_index();
+    }
+    // 立即复制，不等下一次心跳
+    notifyReplicators();
+    return index;
+}
+
+// 注册提交等待
+void RaftCore::waitForCommit(int index, int term, CommitWaiterCallback callback) {
+    bool committed = false;
+    {
+        std::lock_guard<std::mutex> lock(commit_waiter_mutex_);
+        // 已经提交（advanceCommitIndex先更新commit_index_再取锁，不会漏掉）
+        if (index <= commit_index_) {
+            committed = index <= log_store_->snapshot_index() || log_store_->term_at(index) == term;
+        } else if (running_ && state_ == NodeState::LEADER && term == current_term_) {
+            commit_waiters_.emplace(index, CommitWaiter{term, std::move(callback)});
+            return;
+        }
+    }
+    callback(committed);
+}
+
+// 推进提交索引并完成已到达的提交等待
+void RaftCore::advanceCommitIndex(int index) {
+    commit_index_ = index;
+    log_store_->commit(index);
+
+    // 回调在锁外调用，其中可能再取调用者自己的锁
+    std::vector<std::pair<CommitWaiterCallback, bool>> done;
+    {
+        std::lock_guard<std::mutex> lock(commit_waiter_mutex_);
+        auto end = commit_waiters_.upper_bound(index);
+        for (auto it = commit_waiters_.begin(); it != end; ++it) {
+            bool committed = it->first <= log_store_->snapshot_index() || log_store_->term_at(it->first) == it->second.term;
+            done.emplace_back(std::move(it->second.callback), committed);
+        }
+        commit_waiters_.erase(commit_waiters_.begin(), end);
+    }
+    for (auto& waiter : done) {
+        waiter.first(waiter.second);
+    }
+
+    if (commit_callback_) {
+        commit_callback_(index);
+    }
+}
+
+// ReadIndex读
+std::future<int> RaftCore::readIndex() {
+    auto promise = std::make_shared<std::promise<int>>();
+    std::future<int> future = promise->get_future();
+    if (state_ == NodeState::LEADER) {
+        readIndexLocal([promise](int read_index) {
+            promise->set_value(read_index);
+        });
+        return future;
+    }
+
+    // follower向leader查询读索引
+    int leader_id = leader_id_;
+    if (!running_ || state_ != NodeState::FOLLOWER || leader_id == 0) {
+        promise->set_value(-1);
+        return future;
+    }
+    ReadIndexRequest request;
+    request.term = current_term_;
+    request.follower_id = id_;
+    {
+        std::lock_guard<std::mutex> lock(read_mutex_);
+        // 清理调用者已超时放弃的请求：请求被丢弃或leader失联时不会再有响应
+        auto now = std::chrono::steady_clock::now();
+        while (!remote_reads_.empty() && remote_reads_.begin()->second.deadline <= now) {
+            remote_reads_.begin()->second.promise.set_value(-1);
+            remote_reads_.erase(remote_reads_.begin());
+        }
+        request.request_id = ++next_read_id_;
+        remote_reads_.emplace(request.request_id,
+                              RemoteRead{now + std::chrono::milliseconds(COMMAND_WAIT_TIMEOUT_MS), std::move(*promise)});
+    }
+    if (!sendMessage(leader_id, request)) {
+        std::lock_guard<std::mutex> lock(read_mutex_);
+        auto it = remote_reads_.find(request.request_id);
+        if (it != remote_reads_.end()) {
+            it->second.promise.set_value(-1);
+            remote_reads_.erase(it);
+        }
+    }
+    return future;
+}
+
+// leader上登记一个ReadIndex读
+void RaftCore::readIndexLocal(ReadIndexCallback callback) {
+    std::unique_lock<std::mutex> lock(read_mutex_);
+    if (!running_ || state_ != NodeState::LEADER) {
+        lock.unlock();
+        callback(-1);
+        return;
+    }
+    // 当选时先置NOOP_PENDING再发布LEADER，看到LEADER后读到的不会是上一任期的值
+    int noop_index = noop_index_;
+    if (noop_index == NOOP_PENDING) {
+        lock.unlock();
+        callback(-1);
+        return;
+    }
+    // 本任期的空日志提交前，commit_index_可能落后于之前任期已提交的日志
+    int read_index = std::max(commit_index_.load(), noop_index);
+
+    // 当前一轮心跳还没有发给任何节点时加入这一轮，否则开启新的一轮
+    int seq = seq_;
+    bool sent = false;
+    {
+        std::lock_guard<std::mutex> match_lock(match_mutex_);
+        for (int sent_seq : last_sent_seq_) {
+            if (sent_seq == seq) {
+                sent = true;
+                break;
+            }
+        }
+    }
+    if (sent) {
+        seq = ++seq_;
+    }
+    pending_reads_.push_back(PendingRead{seq, read_index, std::move(callback)});
+    lock.unlock();
+
+    if (sent) {
+        notifyReplicators();
+    }
+    // 单节点集群不需要确认
+    confirmReads();
+}
+
+// 处理ReadIndex请求
+void RaftCore::handleReadIndexRequest(int from_node_id, const ReadIndexRequest& request) {
+    auto respond = [this, from_node_id, request](int read_index) {
+        ReadIndexResponse response;
+        response.term = current_term_;
+        response.leader_id = id_;
+        response.request_id = request.request_id;
+        response.read_index = read_index;
+        sendMessage(from_node_id, response);
+    };
+    if (request.term != current_term_) {
+        respond(-1);
+        return;
+    }
+    // 不能在这里阻塞等待：确认所需的心跳响应可能正排在同一节点的消息队列里
+    readIndexLocal(respond);
+}
+
+// 处理ReadIndex响应
+void RaftCore::handleReadIndexResponse(int from_node_id, const ReadIndexResponse& response) {
+    (void)from_node_id;
+    std::lock_guard<std::mutex> lock(read_mutex_);
+    auto it = remote_reads_.find(response.request_id);
+    if (it == remote_reads_.end()) {
+        return;
+    }
+    it->second.promise.set_value(response.term == current_term_ ? response.read_index : -1);
+    remote_reads_.erase(it);
+}
+
+// 多数派确认心跳后完成等待中的读请求
+void RaftCore::confirmReads() {
+    // 多数派（含自己）都确认过的最大序列号
+    std::vector<int> acked;
+    {
+        std::lock_guard<std::mutex> match_lock(match_mutex_);
+        acked = acked_seq_;
+    }
+    int majority = (cluster_size_ / 2) + 1;
+    int quorum_seq = seq_;
+    if (majority > 1) {
+        std::sort(acked.begin(), acked.end(), std::greater<int>());
+        quorum_seq = acked[majority - 2];
+    }
+
+    std::vector<PendingRead> ready;
+    {
+        std::lock_guard<std::mutex> lock(read_mutex_);
+        if (state_ != NodeState::LEADER) {
+            return;
+        }
+        while (!pending_reads_.empty() && pending_reads_.front().seq <= quorum_seq) {
+            ready.push_back(std::move(pending_reads_.front()));
+            pending_reads_.pop_front();
+        }
+    }
+    for (auto& read : ready) {
+        read.callback(read.read_index);
+    }
+}
+
+// 以失败结束所有ReadIndex读
+void RaftCore::failReads() {
+    std::deque<PendingRead> reads;
+    {
+        std::lock_guard<std::mutex> lock(read_mutex_);
+        reads.swap(pending_reads_);
+        for (auto& read : remote_reads_) {
+            read.second.promise.set_value(-1);
+        }
+        remote_reads_.clear();
+    }
+    for (auto& read : reads) {
+        read.callback(-1);
+    }
+}
+
+// 以失败结束所有提交等待
+void RaftCore::failCommitWaiters() {
+    std::multimap<int, CommitWaiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(commit_waiter_mutex_);
+        waiters.swap(commit_waiters_);
+    }
+    for (auto& waiter : waiters) {
+        waiter.second.callback(false);
+    }
 }
 
 // Follower状态循环
 void RaftCore::followerLoop() {   
     while (running_ && state_ == NodeState::FOLLOWER) {
-        // 获取随机选举超时时间
-        int timeout = FOLLOWER_TIMEOUT_MS;
-        // 等待超时时间
-        std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
-        // 检查是否收到心跳
-        if (!received_heartbeat_) {
-            // 未收到心跳，转换为候选者状态
+        // 等待选举计时器到期，期间收到leader消息或投出选票会推迟到期时间
+        {
+            std::unique_lock<std::mutex> lock(timer_mutex_);
+            while (running_ && state_ == NodeState::FOLLOWER &&
+                   std::chrono::steady_clock::now() < election_deadline_) {
+                timer_cv_.wait_until(lock, election_deadline_);
+            }
+        }
+        if (!running_ || state_ != NodeState::FOLLOWER) {
+            break;
+        }
+        // 超时未收到leader消息，先确认多数派愿意投票，再真正发起选举
+        if (preVote()) {
             becomeCandidate();
         } else {
-            // 收到了心跳，重置标志
-            received_heartbeat_ = false;
+            resetElectionTimer();
         }
     }
 }
 
+// Pre-Vote
+bool RaftCore::preVote() {
+    int term = current_term_ + 1;
+    int majority = (cluster_size_ / 2) + 1;
+    pre_vote_term_ = term;
+    pre_vote_count_ = 1;  // 自己同意
+    std::cout << "[RaftCore:] " << id_ << " 发起Pre-Vote, term=" << term << std::endl;
+
+    auto request = std::make_unique<RequestVoteRequest>();
+    request->term = term;
+    request->candidate_id = id_;
+    request->last_log_index = log_store_->latest_index();
+    request->last_log_term = log_store_->latest_term();
+    request->pre_vote = true;
+    for (int peer_id : getPeerNodeIds()) {
+        sendMessage(peer_id, *request);
+    }
+
+    // 在一个选举超时内等待多数派同意；期间任期变化（收到leader消息或更高任期）则放弃
+    auto deadline = std::chrono::steady_clock::now() + randomElectionTimeout();
+    std::unique_lock<std::mutex> lock(timer_mutex_);
+    timer_cv_.wait_until(lock, deadline, [this, term, majority]() {
+        return !running_ || state_ != NodeState::FOLLOWER || current_term_ + 1 != term ||
+               pre_vote_count_ >= majority;
+    });
+    bool granted = running_ && state_ == NodeState::FOLLOWER && current_term_ + 1 == term &&
+                   pre_vote_count_ >= majority;
+    pre_vote_term_ = 0;
+    return granted;
+}
+
+// 随机的选举超时时间
+std::chrono::milliseconds RaftCore::randomElectionTimeout() {
+    thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<int> dis(ELECTION_TIMEOUT_MIN_MS, ELECTION_TIMEOUT_MAX_MS);
+    int timeout = dis(gen);
+    // 多组时每个组有一个首选leader节点，其他节点晚一些发起选举，使各组leader分散开
+    if (RAFT_GROUP_COUNT > 1 && group_id_ % cluster_size_ + 1 != id_) {
+        timeout += GROUP_LEADER_PREFERENCE_MS;
+    }
+    return std::chrono::milliseconds(timeout);
+}
+
+// 重置选举计时器
+void RaftCore::resetElectionTimer() {
+    auto deadline = std::chrono::steady_clock::now() + randomElectionTimeout();
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    election_deadline_ = deadline;
+}
+
+// 收到当前leader的消息
+void RaftCore::touchLeader() {
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = now + randomElectionTimeout();
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    last_leader_contact_ = now;
+    election_deadline_ = deadline;
+}
+
+// 最近是否收到过leader的消息
+bool RaftCore::leaderRecentlyActive() {
+    if (state_ == NodeState::LEADER) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    return leader_id_ != 0 &&
+           std::chrono::steady_clock::now() - last_leader_contact_ < std::chrono::milliseconds(ELECTION_TIMEOUT_MIN_MS);
+}
+
+// 唤醒等待计时器或投票结果的线程
+void RaftCore::notifyTimer() {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    timer_cv_.notify_all();
+}
+
+// leader是否与多数派保持联系
+bool RaftCore::hasQuorumContact() {
+    int majority = (cluster_size_ / 2) + 1;
+    int count = 1;  // 自己
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(match_mutex_);
+    for (const auto& last_contact : last_contact_time_) {
+        if (now - last_contact <= std::chrono::milliseconds(ELECTION_TIMEOUT_MAX_MS)) {
+            count++;
+        }
+    }
+    return count >= majority;
+}
+
 // 获取其他节点ID列表
 std::vector<int> RaftCore::getPeerNodeIds() const {
     std::vector<int> peers;
@@ -198,17 +596,21 @@ int RaftCore::nodeIdToIndex(int node_id) const {
 
 // Candidate状态循环
 void RaftCore::candidateLoop() {
-    // 创建随机数生成器
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(ELECTION_TIMEOUT_MIN_MS, ELECTION_TIMEOUT_MAX_MS);
-    
     while (running_ && state_ == NodeState::CANDIDATE) {
-        // 设置已投票标志
-        voted_ = true;  // 已经给自己投票
-        // 开始新的选举
-        current_term_++;//任期+1
-        vote_count_ = 1;  // 先给自己投一票
+        // 开始新的选举，先给自己投一票
+        {
+            std::lock_guard<std::mutex> lock(vote_mutex_);
+            current_term_++;//任期+1
+            voted_ = true;
+            voted_for_ = id_;
+            vote_count_ = 1;
+            persistHardState();
+        }
+        if (vote_count_ >= (cluster_size_ / 2) + 1) {
+            // 单节点集群
+            becomeLeader();
+            break;
+        }
         
         // 向其他节点发送投票请求
         std::vector<int> peer_ids = getPeerNodeIds();
@@ -217,37 +619,44 @@ void RaftCore::candidateLoop() {
             sendRequestVote(peer_id);
         }
         
-        // 等待随机的选举超时时间
-        int timeout = dis(gen);
-        std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+        // 等待选举结果，最多一个随机的选举超时
+        auto deadline = std::chrono::steady_clock::now() + randomElectionTimeout();
+        {
+            std::unique_lock<std::mutex> lock(timer_mutex_);
+            timer_cv_.wait_until(lock, deadline, [this]() {
+                return !running_ || state_ != NodeState::CANDIDATE;
+            });
+        }
         
         // 检查状态
-        if (state_ == NodeState::CANDIDATE) {
-            // 选举超时，回到Follower状态
+        if (running_ && state_ == NodeState::CANDIDATE) {
+            // 选举超时（票数被瓜分），回到Follower状态，随机等待后重新Pre-Vote
             becomeFollower(current_term_);
             std::cout << "[RaftCore:] " << id_ << " 未获得多数票，变回follower" << std::endl;
         }
-        // 重置投票标志
-        voted_ = false;
     }
 }
 
 // Leader状态循环
 void RaftCore::leaderLoop() {
     while (running_ && state_ == NodeState::LEADER) {
-        // 发送心跳
-        std::vector<int> peer_ids = getPeerNodeIds();
-        seq_=seq_==10?0:seq_+1;//seq_是心跳序列号，每10次心跳后重置为0
-        for (int peer_id : peer_ids) {
-            sendAppendEntries(peer_id, true);
-        }
+        // 开始新一轮心跳：本轮还没发送过请求的follower由复制线程补发心跳
+        seq_++;//seq_是心跳序列号，ReadIndex读也会开启新的一轮
+        notifyReplicators();
         
         // 等待心跳间隔
-        std::this_thread::sleep_for(std::chrono::milliseconds(HEARTBEAT_INTERVAL_MS));
+        {
+            std::unique_lock<std::mutex> lock(timer_mutex_);
+            timer_cv_.wait_for(lock, std::chrono::milliseconds(HEARTBEAT_INTERVAL_MS), [this]() {
+                return !running_ || state_ != NodeState::LEADER;
+            });
+        }
+        if (!running_ || state_ != NodeState::LEADER) {
+            break;
+        }
         
-        // 检查Leader的存活计数
-        live_count_--;
-        if (live_count_ < 0) {
+        // 检查Leader是否仍与多数派保持联系
+        if (!hasQuorumContact()) {
             // 长时间未收到大多数节点的响应，怀疑网络分区，退回到Follower状态
             becomeFollower(current_term_);
             std::cout <<"[RaftCore:] " << id_ << " 出现网络链接问题，退回到follower" << std::endl;
@@ -256,17 +665,108 @@ void RaftCore::leaderLoop() {
     }
 }
 
+// 复制线程循环
+void RaftCore::replicatorLoop(int peer_id) {
+    int idx = nodeIdToIndex(peer_id);
+    if (idx < 0) {
+        return;
+    }
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> lock(replicate_mutex_);
+            replicate_cv_.wait_for(lock, std::chrono::milliseconds(HEARTBEAT_INTERVAL_MS), [this, idx]() {
+                if (!running_) {
+                    return true;
+                }
+                if (state_ != NodeState::LEADER) {
+                    return false;
+                }
+                std::lock_guard<std::mutex> match_lock(match_mutex_);
+                return hasReplicationWork(idx, std::chrono::steady_clock::now());
+            });
+        }
+        if (!running_ || state_ != NodeState::LEADER) {
+            continue;
+        }
+
+        // 有待发送的日志时发送日志，否则本轮补发一次心跳
+        bool is_heartbeat = false;
+        {
+            std::lock_guard<std::mutex> match_lock(match_mutex_);
+            if (!hasReplicationWork(idx, std::chrono::steady_clock::now())) {
+                continue;
+            }
+            is_heartbeat = next_index_[idx] > log_store_->latest_index() || inflight_[idx] >= MAX_INFLIGHT_APPEND;
+        }
+        sendAppendEntries(peer_id, is_heartbeat);
+    }
+}
+
+// 是否有需要立即发送给某个follower的请求
+bool RaftCore::hasReplicationWork(int idx, std::chrono::steady_clock::time_point now) {
+    // 上次发送失败，暂停一段时间再重连
+    if (now < retry_after_[idx]) {
+        return false;
+    }
+    // 在途请求长时间没有响应（消息丢失），从matchIndex重新发送
+    if (inflight_[idx] > 0 && now - last_response_time_[idx] > std::chrono::milliseconds(REPLICATION_TIMEOUT_MS)) {
+        next_index_[idx] = match_index_[idx] + 1;
+        inflight_[idx] = 0;
+    }
+    // 本轮心跳还没有发送过任何请求
+    if (last_sent_seq_[idx] != seq_) {
+        return true;
+    }
+    return next_index_[idx] <= log_store_->latest_index() && inflight_[idx] < MAX_INFLIGHT_APPEND;
+}
+
+// 唤醒所有复制线程
+void RaftCore::notifyReplicators() {
+    std::lock_guard<std::mutex> lock(replicate_mutex_);
+    replicate_cv_.notify_all();
+}
+
+// 查找任期不超过term的最后一条日志
+int RaftCore::lastIndexUpToTerm(int term) const {
+    int low = log_store_->snapshot_index();
+    int high = log_store_->latest_index();
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (log_store_->term_at(mid) <= term) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
 // 成为Follower
 void RaftCore::becomeFollower(int term) {
-    // 更新状态和任期
-    state_ = NodeState::FOLLOWER;
-    current_term_ = term;
-    leader_id_ = 0;  // 未知的领导者
-    
-    // 重置其他状态
-    voted_ = false;
-    vote_count_ = 0;
-    received_heartbeat_ = false;
+    // 更新状态和任期；同一任期内已投出的票必须保留，否则可能投给两个候选者
+    {
+        std::lock_guard<std::mutex> lock(vote_mutex_);
+        state_ = NodeState::FOLLOWER;
+        if (term > current_term_) {
+            current_term_ = term;
+            voted_ = false;
+            voted_for_ = 0;
+        }
+        leader_id_ = 0;  // 未知的领导者
+        vote_count_ = 0;
+        persistHardState();
+    }
+    resetElectionTimer();
+    notifyTimer();
+
+    // 不再是leader，等待中的客户端请求无法确认提交
+    failCommitWaiters();
+    failReads();
+}
+
+// 持久化当前任期和投票对象
+void RaftCore::persistHardState() {
+    log_store_->save_hard_state(current_term_, voted_ ? voted_for_.load() : 0);
 }
 
 
@@ -279,27 +779,55 @@ void RaftCore::becomeCandidate() {
 
 // 成为Leader
 void RaftCore::becomeLeader() {
-    // 更新状态
-    state_ = NodeState::LEADER;
+    // 更新状态（多个投票响应可能同时达到多数），与降级互斥以记下当选的任期
+    int term = 0;
+    {
+        std::lock_guard<std::mutex> lock(vote_mutex_);
+        if (state_ != NodeState::CANDIDATE) {
+            return;
+        }
+        // 空日志追加之前拒绝ReadIndex读
+        noop_index_ = NOOP_PENDING;
+        state_ = NodeState::LEADER;
+        term = current_term_;
+        leader_term_ = term;
+    }
     leader_id_ = id_;
     seq_ = 0;
-    live_count_ = LEADER_RESILIENCE_COUNT;
+    notifyTimer();
     
     // 初始化Leader状态数据
-    // 在这里加锁是因为match_index_和match_term_是共享资源
+    // 在这里加锁是因为每个follower的复制状态是共享资源
     // 因此需要互斥锁来保护这些共享资源,防止数据竞争
-    std::lock_guard<std::mutex> lock(match_mutex_);//加锁
-    
-    // 获取最新日志信息
-    int latest_term = log_store_->latest_term();
-    // 获取最新日志索引
-    int latest_index = log_store_->latest_index();
-    for (int i = 0; i < cluster_size_ - 1; ++i) {
-        match_index_[i] = latest_index;
-        match_term_[i] = latest_term;
-    }
-    std::cout <<"[RaftCore:] " << id_ << " become leader, term=" << current_term_ << std::endl;
-    
+    {
+        std::lock_guard<std::mutex> lock(match_mutex_);//加锁
+        
+        // 获取最新日志索引，nextIndex从其后开始，matchIndex待follower确认
+        int latest_index = log_store_->latest_index();
+        auto now = std::chrono::steady_clock::now();
+        for (int i = 0; i < cluster_size_ - 1; ++i) {
+            match_index_[i] = 0;
+            match_term_[i] = 0;
+            next_index_[i] = latest_index + 1;
+            inflight_[i] = 0;
+            last_sent_seq_[i] = -1;
+            acked_seq_[i] = -1;
+            last_response_time_[i] = now;
+            last_contact_time_[i] = now;
+            retry_after_[i] = std::chrono::steady_clock::time_point();
+        }
+    }
+    std::cout <<"[RaftCore:] " << id_ << " become leader, term=" << term << std::endl;
+
+    // 追加一条本任期的空日志，它提交后之前任期的日志也随之提交，ReadIndex才能给出正确的读索引
+    int noop_index = appendLogEntry("", term);
+    {
+        // 期间已进入新任期时，新任期的NOOP_PENDING不能被覆盖
+        std::lock_guard<std::mutex> lock(vote_mutex_);
+        if (noop_index > 0 && current_term_ == term) {
+            noop_index_ = noop_index;
+        }
+    }
 }
 
 
@@ -309,10 +837,30 @@ void RaftCore::becomeLeader() {
 std::unique_ptr<Message> RaftCore::handleRequestVote(int from_node_id, const RequestVoteRequest& request) {
     // from_node_id参数未使用，但保留接口一致性
     //(void)from_node_id;
-    std::cout<<"[RaftCore:] " << id_ << " 收到来自节点 " << from_node_id << " 的投票请求" << std::endl;
+    std::cout<<"[RaftCore:] " << id_ << " 收到来自节点 " << from_node_id << " 的" << (request.pre_vote ? "Pre-Vote" : "投票") << "请求" << std::endl;
     auto response = std::make_unique<RequestVoteResponse>();
     //Job1:收到来自其他节点的投票请求，补全代码，构造回复给请求者的回应信息
 
+    // 检查候选人的日志是否至少和自己一样新
+    auto logUpToDate = [this, &request]() {
+        int my_last_log_index = log_store_->latest_index();
+        int my_last_log_term = log_store_->latest_term();
+        return request.last_log_term > my_last_log_term ||
+               (request.last_log_term == my_last_log_term && request.last_log_index >= my_last_log_index);
+    };
+
+    // Pre-Vote：只回答能否投票，不改变任期和投票状态
+    // 最近还收到过leader消息时拒绝，被隔离的节点回来后不会打断现任leader
+    if (request.pre_vote) {
+        response->pre_vote = true;
+        response->vote_granted = request.term > current_term_ && !leaderRecentlyActive() && logUpToDate();
+        response->term = response->vote_granted ? request.term : current_term_.load();
+        return response;
+    }
+
+    // 同一时刻只处理一个投票请求，保证一个任期只投一票
+    std::unique_lock<std::mutex> lock(vote_mutex_);
+
     // 设置响应的任期
     response->term = current_term_;
     response->vote_granted = false;
@@ -324,33 +872,29 @@ std::unique_ptr<Message> RaftCore::handleRequestVote(int from_node_id, const Req
     
     // 2. 如果候选人的任期大于当前任期，更新任期并转为follower
     if (request.term > current_term_) {
+        lock.unlock();
         becomeFollower(request.term);
+        lock.lock();
+        if (request.term != current_term_) {
+            response->term = current_term_;
+            return response;
+        }
         response->term = current_term_;
     }
     
-    // 3. 检查是否已经投票
-    if (voted_) {
+    // 3. 检查是否已经投票（重复的请求仍然同意同一个候选人）
+    if (voted_ && voted_for_ != request.candidate_id) {
         return response;
     }
     
-    // 4. 检查候选人的日志是否至少和自己一样新
-    int my_last_log_index = log_store_->latest_index();
-    int my_last_log_term = log_store_->latest_term();
-    
-    bool log_ok = false;
-    if (request.last_log_term > my_last_log_term) {
-        log_ok = true;
-    } else if (request.last_log_term == my_last_log_term && 
-               request.last_log_index >= my_last_log_index) {
-        log_ok = true;
-    }
-    
-    // 5. 如果日志检查通过，投票给候选人
-    if (log_ok) {
+    // 4. 如果候选人的日志至少和自己一样新，投票给候选人
+    if (logUpToDate()) {
         voted_ = true;
+        voted_for_ = request.candidate_id;
+        persistHardState();
         response->vote_granted = true;
-        // 重置心跳标志，因为参与了选举
-        received_heartbeat_ = true;
+        // 参与了选举，重置选举计时器
+        resetElectionTimer();
     }
 
     return response;
@@ -362,18 +906,28 @@ std::unique_ptr<Message> RaftCore::handleRequestVote(int from_node_id, const Req
 void RaftCore::handleRequestVoteResponse(int from_node_id, const RequestVoteResponse& response) {
     // from_node_id参数未使用，但保留接口一致性
     //(void)from_node_id;
-    std::cout<<"[RaftCore:] " << id_ << " 收到来自节点 " << from_node_id << " 的投票响应" << std::endl;
-    // 只有在candidate状态才处理投票响应
-    if (state_ != NodeState::CANDIDATE) {
-        return;
-    }
+    std::cout<<"[RaftCore:] " << id_ << " 收到来自节点 " << from_node_id << " 的" << (response.pre_vote ? "Pre-Vote" : "投票") << "响应" << std::endl;
     //Job2:收到来自其他节点的投票回应，补全代码，做出对应的反应
 
-    // 1. 如果响应的任期大于当前任期，转为follower
-    if (response.term > current_term_) {
+    // 1. 如果响应的任期大于当前任期，转为follower（同意的Pre-Vote带回的是请求中的任期，不算）
+    if (response.term > current_term_ && !(response.pre_vote && response.vote_granted)) {
         becomeFollower(response.term);
         return;
     }
+
+    // Pre-Vote响应：只统计本轮Pre-Vote的同意数
+    if (response.pre_vote) {
+        if (response.vote_granted && state_ == NodeState::FOLLOWER && response.term == pre_vote_term_) {
+            pre_vote_count_++;
+            notifyTimer();
+        }
+        return;
+    }
+
+    // 只有在candidate状态才处理投票响应，过期任期的选票不计入
+    if (state_ != NodeState::CANDIDATE || response.term != current_term_) {
+        return;
+    }
     
     // 2. 如果获得投票，增加票数
     if (response.vote_granted) {
@@ -391,12 +945,13 @@ void RaftCore::handleRequestVoteResponse(int from_node_id, const RequestVoteResp
 
 // 处理AppendEntries请求
 std::unique_ptr<Message> RaftCore::handleAppendEntries(int from_node_id, const AppendEntriesRequest& request) {
-    // from_node_id参数未使用，但保留接口一致性
-    //(void)from_node_id;
     //std::cout<<"[RaftCore:] " << id_ << " 收到来自节点 " << from_node_id << " 的日志同步请求" << std::endl;
     auto response = std::make_unique<AppendEntriesResponse>();
     //Job3:收到来自leader节点的日志同步请求（心跳），补全代码，构造正确的回应消息
 
+    // leader会流水线发送多个请求，逐个处理
+    std::lock_guard<std::mutex> lock(append_entries_mutex_);
+
     // 设置响应基本信息
     response->term = current_term_;
     response->follower_id = id_;
@@ -419,115 +974,295 @@ std::unique_ptr<Message> RaftCore::handleAppendEntries(int from_node_id, const A
         
         // 更新leader信息
         leader_id_ = request.leader_id;
-        // 重置心跳标志
-        received_heartbeat_ = true;
+        // 重置选举计时器
+        touchLeader();
     }
     
-    // 3. 检查日志一致性
-    if (request.prev_log_index > 0) {
+    // 3. 检查日志一致性（快照覆盖的日志都已提交，必然一致）
+    // 失败时带回冲突提示，leader可以一次跳过整个任期
+    int snapshot_index = log_store_->snapshot_index();
+    if (request.prev_log_index > snapshot_index) {
         // 检查是否存在前一个日志条目
-        if (request.prev_log_index > log_store_->latest_index()) {
-            // 缺少前一个日志条目
+        int latest_index = log_store_->latest_index();
+        if (request.prev_log_index > latest_index) {
+            // 缺少前一个日志条目，从最新日志之后开始发送
+            response->conflict_term = 0;
+            response->conflict_index = latest_index + 1;
             return response;
         }
         
         // 检查前一个日志条目的任期是否匹配
-        if (log_store_->term_at(request.prev_log_index) != request.prev_log_term) {
-            // 任期不匹配，删除冲突的日志条目
-            log_store_->erase(request.prev_log_index, log_store_->latest_index());
+        int conflict_term = log_store_->term_at(request.prev_log_index);
+        if (conflict_term != request.prev_log_term) {
+            // 任期不匹配，返回该任期在本地的第一条日志；冲突的日志等追加时再截断
+            response->conflict_term = conflict_term;
+            response->conflict_index = lastIndexUpToTerm(conflict_term - 1) + 1;
             return response;
         }
     }
     
     // 4. 附加新的日志条目
-    if (!request.entries.empty()) {
-        // 从prev_log_index + 1开始附加日志
-        int next_index = request.prev_log_index + 1;
-        
-        // 删除可能冲突的日志条目
-        if (next_index <= log_store_->latest_index()) {
-            log_store_->erase(next_index, log_store_->latest_index());
+    // 已被快照覆盖或本地已有的相同条目直接跳过，只在任期冲突处截断
+    // （重复或乱序到达的旧请求不能截掉已确认给leader的日志）
+    int index = request.prev_log_index;
+    for (const auto& entry : request.entries) {
+        ++index;
+        if (index <= snapshot_index) {
+            continue;
         }
-        
-        // 附加新的日志条目
-        for (const auto& entry : request.entries) {
-            log_store_->append(entry.data, entry.term);
+        int latest_index = log_store_->latest_index();
+        if (index <= latest_index) {
+            if (log_store_->term_at(index) == entry.term) {
+                continue;
+            }
+            log_store_->erase(index, latest_index);
+            dropPendingAcks(index);
         }
+        log_store_->append(entry.data, entry.term);
     }
+    int last_new_index = index;
     
-    // 5. 更新提交索引
+    // 5. 更新提交索引（只能提交已与leader确认一致的部分）
     if (request.leader_commit > commit_index_) {
-        int new_commit_index = std::min(request.leader_commit, log_store_->latest_index());
-        commit_index_ = new_commit_index;
-        log_store_->commit(commit_index_);
+        int new_commit_index = std::min(request.leader_commit, last_new_index);
+        if (new_commit_index > commit_index_) {
+            advanceCommitIndex(new_commit_index);
+        }
     }
     
-    // 6. 设置成功响应
+    // 6. 日志持久化后才能确认：尚未持久化时登记下来，由组提交刷盘后的回调发送确认
+    // （不在锁内等待，流水线上后续的请求可以追加进同一次fdatasync）
+    if (last_new_index > log_store_->durable_index()) {
+        std::lock_guard<std::mutex> ack_lock(pending_ack_mutex_);
+        // 持锁再检查一次：回调在推进持久化索引之后才取该锁，不会漏掉这次登记
+        if (last_new_index > log_store_->durable_index()) {
+            pending_acks_.push_back(PendingAck{from_node_id, last_new_index, current_term_, request.seq});
+            return nullptr;
+        }
+    }
+
+    // 7. 设置成功响应
     response->success = true;
-    response->log_index = log_store_->latest_index();
+    response->log_index = last_new_index;
     response->follower_commit = commit_index_;
 
     return response;
 }
 
+// 日志持久化后确认等待中的AppendEntries（follower）
+void RaftCore::sendDurableAcks() {
+    std::vector<PendingAck> ready;
+    {
+        std::lock_guard<std::mutex> lock(pending_ack_mutex_);
+        if (pending_acks_.empty()) {
+            return;
+        }
+        // 重新读取持久化索引：回调参数可能早于一次截断
+        int durable = log_store_->durable_index();
+        auto it = pending_acks_.begin();
+        while (it != pending_acks_.end()) {
+            if (it->term != current_term_) {
+                // 已进入新任期，旧leader的请求不再确认
+                it = pending_acks_.erase(it);
+            } else if (it->index <= durable) {
+                ready.push_back(*it);
+                it = pending_acks_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (const auto& ack : ready) {
+        AppendEntriesResponse response;
+        response.term = ack.term;
+        response.follower_id = id_;
+        response.success = true;
+        response.log_index = ack.index;
+        response.follower_commit = commit_index_;
+        response.ack = ack.seq;
+        sendMessage(ack.leader_id, response);
+    }
+}
+
+// 丢弃确认范围包含from_index及之后日志的等待确认（这些日志被截断或停止时调用）
+void RaftCore::dropPendingAcks(int from_index) {
+    std::lock_guard<std::mutex> lock(pending_ack_mutex_);
+    pending_acks_.erase(std::remove_if(pending_acks_.begin(), pending_acks_.end(),
+                                       [from_index](const PendingAck& ack) { return ack.index >= from_index; }),
+                        pending_acks_.end());
+}
+
 // 处理AppendEntries响应
 void RaftCore::handleAppendEntriesResponse(int from_node_id, const AppendEntriesResponse& response) {
-    // from_node_id参数未使用，但保留接口一致性
-    //(void)from_node_id;
     // 只有在Leader状态下才处理AppendEntries响应
     if (state_ != NodeState::LEADER) {
         return;
     }
     //Job4:收到来自follower节点的日志同步回应，补全代码，做出正确的反应
 
-    // 1. 如果响应的任期大于当前任期，转为follower
+    // 1. 如果响应的任期大于当前任期，转为follower；过期任期的响应直接丢弃
     if (response.term > current_term_) {
         becomeFollower(response.term);
         return;
     }
-    
-    // 2. 检查响应的序列号是否匹配
-    if (response.ack == seq_) {
-        // 增加存活计数，表明收到了有效响应
-        live_count_++;
+    if (response.term < current_term_) {
+        return;
+    }
+    int idx = nodeIdToIndex(from_node_id);
+    if (idx < 0 || idx >= static_cast<int>(match_index_.size())) {
+        return;
     }
     
-    // 3. 如果响应成功，更新该节点的匹配信息
-    if (response.success) {
-        int idx = nodeIdToIndex(from_node_id);
-        if (idx >= 0 && idx < static_cast<int>(match_index_.size())) {
-            std::lock_guard<std::mutex> lock(match_mutex_);
-            // 更新match_index_，表示该节点已经复制的最高日志索引
-            match_index_[idx] = response.log_index;
-            // 更新match_term_，表示该节点已经复制的最高日志任期
-            if (response.log_index > 0) {
+    {
+        std::lock_guard<std::mutex> lock(match_mutex_);
+
+        // 2. 同任期的响应说明对方仍承认自己是leader
+        acked_seq_[idx] = std::max(acked_seq_[idx], response.ack);
+        last_response_time_[idx] = std::chrono::steady_clock::now();
+        last_contact_time_[idx] = last_response_time_[idx];
+        if (inflight_[idx] > 0) {
+            inflight_[idx]--;
+        }
+
+        if (response.success) {
+            // 3. 响应成功，更新该节点的匹配信息（流水线下响应可能乱序，只增不减）
+            if (response.log_index > match_index_[idx]) {
+                match_index_[idx] = response.log_index;
                 match_term_[idx] = log_store_->term_at(response.log_index);
             }
-        }
-        
-        // 4. 检查是否可以更新提交索引
-        // 统计有多少节点已经复制了某个日志条目
-        int current_log_index = log_store_->latest_index();
-        for (int log_idx = commit_index_ + 1; log_idx <= current_log_index; ++log_idx) {
-            int count = 1; // 包括leader自己
-            
-            {
-                std::lock_guard<std::mutex> lock(match_mutex_);
-                for (int i = 0; i < static_cast<int>(match_index_.size()); ++i) {
-                    if (match_index_[i] >= log_idx) {
-                        count++;
-                    }
+            next_index_[idx] = std::max(next_index_[idx], match_index_[idx] + 1);
+        } else {
+            // 日志不一致：根据冲突提示回退nextIndex，丢弃在途请求
+            // - 跟随者缺少日志：从其最新日志之后发送
+            // - 任期冲突：若本地也有该任期，从本地该任期最后一条之后发送，否则跳过跟随者的整个冲突任期
+            // （若需要的日志已被压缩，下次会改为发送快照）
+            int next_index = response.conflict_index;
+            if (response.conflict_term > 0) {
+                int last_index = lastIndexUpToTerm(response.conflict_term);
+                if (last_index > 0 && log_store_->term_at(last_index) == response.conflict_term) {
+                    next_index = last_index + 1;
                 }
             }
-            
-            // 如果超过半数节点已经复制了该日志条目，且该条目是当前任期的，可以提交
-            int majority = (cluster_size_ / 2) + 1;
-            if (count >= majority && log_store_->term_at(log_idx) == current_term_) {
-                commit_index_ = log_idx;
-                log_store_->commit(commit_index_);
-            }
+            next_index_[idx] = std::max(match_index_[idx] + 1, std::min(next_index_[idx], next_index));
+            inflight_[idx] = 0;
         }
     }
+
+    // 4. 检查是否可以更新提交索引，以及能否确认等待中的读请求
+    if (response.success) {
+        updateCommitIndex();
+    }
+    confirmReads();
+    // 窗口空出，继续发送
+    notifyReplicators();
+}
+
+// 更新提交索引
+void RaftCore::updateCommitIndex() {
+    if (state_ != NodeState::LEADER) {
+        return;
+    }
+    std::lock_guard<std::mutex> commit_lock(commit_update_mutex_);
+
+    // 各节点已复制到的位置（leader自己只计已持久化的部分），降序排列后第majority个即多数派都已复制的最大索引
+    std::vector<int> replicated;
+    replicated.reserve(cluster_size_);
+    replicated.push_back(log_store_->durable_index());
+    {
+        std::lock_guard<std::mutex> lock(match_mutex_);
+        replicated.insert(replicated.end(), match_index_.begin(), match_index_.end());
+    }
+    int majority = (cluster_size_ / 2) + 1;
+    std::nth_element(replicated.begin(), replicated.begin() + (majority - 1), replicated.end(), std::greater<int>());
+    int quorum_index = replicated[majority - 1];
+
+    // 只能直接提交当前任期的日志，之前任期的日志随之提交
+    int new_commit_index = commit_index_;
+    if (quorum_index > new_commit_index && log_store_->term_at(quorum_index) == current_term_) {
+        new_commit_index = quorum_index;
+    }
+    if (new_commit_index > commit_index_) {
+        advanceCommitIndex(new_commit_index);
+    }
+}
+
+// 处理InstallSnapshot请求
+std::unique_ptr<Message> RaftCore::handleInstallSnapshot(int from_node_id, const InstallSnapshotRequest& request) {
+    std::cout << "[RaftCore:] " << id_ << " 收到来自节点 " << from_node_id << " 的快照, index="
+              << request.last_included_index << ", term=" << request.last_included_term << std::endl;
+    auto response = std::make_unique<InstallSnapshotResponse>();
+    std::lock_guard<std::mutex> lock(append_entries_mutex_);
+    response->term = current_term_;
+    response->follower_id = id_;
+    response->last_included_index = log_store_->snapshot_index();
+    response->success = false;
+
+    // 1. 如果请求的任期小于当前任期，拒绝
+    if (request.term < current_term_) {
+        return response;
+    }
+
+    // 2. 承认对方为leader
+    if (request.term > current_term_ || state_ != NodeState::FOLLOWER) {
+        becomeFollower(request.term);
+    }
+    response->term = current_term_;
+    leader_id_ = request.leader_id;
+    touchLeader();
+
+    // 3. 快照覆盖的日志已经提交过，无需安装
+    if (request.last_included_index <= commit_index_) {
+        response->success = true;
+        response->last_included_index = request.last_included_index;
+        return response;
+    }
+
+    // 4. 持久化快照，恢复状态机，然后压缩日志
+    if (!snapshot_store_->save(request.last_included_index, request.last_included_term, request.data)) {
+        return response;
+    }
+    if (install_snapshot_callback_ &&
+        !install_snapshot_callback_(request.last_included_index, request.last_included_term, request.data)) {
+        return response;
+    }
+    commit_index_ = std::max(commit_index_.load(), request.last_included_index);
+    log_store_->compact(request.last_included_index, request.last_included_term);
+    // 与快照冲突的日志已被整体丢弃
+    dropPendingAcks(request.last_included_index + 1);
+
+    response->success = true;
+    response->last_included_index = request.last_included_index;
+    return response;
+}
+
+// 处理InstallSnapshot响应
+void RaftCore::handleInstallSnapshotResponse(int from_node_id, const InstallSnapshotResponse& response) {
+    if (state_ != NodeState::LEADER) {
+        return;
+    }
+    if (response.term > current_term_) {
+        becomeFollower(response.term);
+        return;
+    }
+    if (response.term < current_term_) {
+        return;
+    }
+    int idx = nodeIdToIndex(from_node_id);
+    if (idx < 0 || idx >= static_cast<int>(match_index_.size())) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(match_mutex_);
+        last_response_time_[idx] = std::chrono::steady_clock::now();
+        last_contact_time_[idx] = last_response_time_[idx];
+        inflight_[idx] = 0;
+        if (response.success) {
+            match_index_[idx] = std::max(match_index_[idx], response.last_included_index);
+            match_term_[idx] = log_store_->term_at(match_index_[idx]);
+        }
+        next_index_[idx] = match_index_[idx] + 1;
+    }
+    notifyReplicators();
 }
 
 
@@ -559,6 +1294,11 @@ void RaftCore::sendAppendEntries(int target_id, bool is_heartbeat) {
     if (target_id == id_) {
         return;  // 不向自己发送
     }
+    int idx = nodeIdToIndex(target_id);
+    if (idx < 0 || idx >= static_cast<int>(match_index_.size())) {
+        std::cerr << "Unknown target node ID: " << target_id << std::endl;
+        return;
+    }
 
     // 创建AppendEntries请求
     auto request = std::make_unique<AppendEntriesRequest>();
@@ -566,51 +1306,83 @@ void RaftCore::sendAppendEntries(int target_id, bool is_heartbeat) {
     request->leader_id = id_;
     request->seq = seq_;
     
-    // 获取目标节点的下一个日志索引
+    // 确定本次发送的日志范围，并乐观地推进nextIndex以便流水线发送下一批
+    int snapshot_index = log_store_->snapshot_index();
+    int last_index = log_store_->latest_index();
     int prev_log_index = 0;
-    int prev_log_term = 0;
+    int end_index = 0;
+    bool need_snapshot = false;
     {
         std::lock_guard<std::mutex> lock(match_mutex_);
-        
-        int idx = nodeIdToIndex(target_id);
-        if (idx >= 0 && idx < static_cast<int>(match_index_.size())) {
-            prev_log_index = match_index_[idx];
+        auto now = std::chrono::steady_clock::now();
+        last_sent_seq_[idx] = request->seq;
+        if (is_heartbeat) {
+            // 心跳从已确认的位置校验，不携带日志
+            prev_log_index = std::min(std::max(match_index_[idx], snapshot_index), last_index);
+            end_index = prev_log_index;
+        } else if (next_index_[idx] - 1 < snapshot_index) {
+            // 需要的日志已被压缩进快照，改为发送快照，收到响应前不再发送
+            need_snapshot = true;
+            next_index_[idx] = snapshot_index + 1;
+            inflight_[idx] = MAX_INFLIGHT_APPEND;
+            last_response_time_[idx] = now;
         } else {
-            std::cout << "Sending message to node " << target_id << std::endl;
-            std::cerr << "Unknown target node ID: " << target_id << std::endl;
+            prev_log_index = next_index_[idx] - 1;
+            end_index = std::min(last_index, prev_log_index + BATCH_SIZE);
+            next_index_[idx] = end_index + 1;
+            if (inflight_[idx] == 0) {
+                last_response_time_[idx] = now;
+            }
+            inflight_[idx]++;
+        }
+    }
+
+    bool success = false;
+    if (need_snapshot) {
+        success = sendInstallSnapshot(target_id);
+    } else {
+        request->prev_log_index = prev_log_index;
+        request->prev_log_term = prev_log_index > 0 ? log_store_->term_at(prev_log_index) : 0;
+        request->leader_commit = commit_index_;
+        for (int i = prev_log_index + 1; i <= end_index; ++i) {
+            request->addEntry(log_store_->term_at(i), log_store_->entry_at(i));
+        }
+        // 读取期间日志被压缩，任期不可信，放弃本次发送
+        if (log_store_->snapshot_index() > prev_log_index) {
+            std::lock_guard<std::mutex> lock(match_mutex_);
+            next_index_[idx] = match_index_[idx] + 1;
+            inflight_[idx] = 0;
             return;
         }
+        // 发送请求
+        success = sendMessage(target_id, *request);
     }
-    
-    // 获取前一个日志的任期
-    if (prev_log_index > 0) {
-        prev_log_term = log_store_->term_at(prev_log_index);
+
+    // 发送失败（连接断开），从matchIndex重新开始，并暂停一个心跳间隔再重试
+    if (!success) {
+        std::lock_guard<std::mutex> lock(match_mutex_);
+        next_index_[idx] = match_index_[idx] + 1;
+        inflight_[idx] = 0;
+        retry_after_[idx] = std::chrono::steady_clock::now() + std::chrono::milliseconds(HEARTBEAT_INTERVAL_MS);
     }
-    
-    request->prev_log_index = prev_log_index;
-    request->prev_log_term = prev_log_term;
-    request->leader_commit = commit_index_;
-    
-    // 如果是心跳，则不附加日志条目
-    if (is_heartbeat) {
-        // 添加日志条目
-        int next_index = prev_log_index + 1;
-        int last_index = log_store_->latest_index();
-        
-        for (int i = next_index; i <= last_index && i <= next_index + BATCH_SIZE; ++i) {
-            LogEntry entry;
-            entry.term = log_store_->term_at(i);
-            entry.data = log_store_->entry_at(i);
-            request->entries.push_back(entry);
-        }
+}
+
+// 发送InstallSnapshot请求
+bool RaftCore::sendInstallSnapshot(int target_id) {
+    auto request = std::make_unique<InstallSnapshotRequest>();
+    request->term = current_term_;
+    request->leader_id = id_;
+    if (!snapshot_store_->read(request->last_included_index, request->last_included_term, request->data)) {
+        std::cerr << "[RaftCore:] " << "读取快照失败，无法发送给节点 " << target_id << std::endl;
+        return false;
     }
-    
-    // 发送请求
-    sendMessage(target_id, *request);
+    std::cout << "[RaftCore:] " << "向节点 " << target_id << " 发送快照, index=" << request->last_included_index << std::endl;
+    return sendMessage(target_id, *request);
 }
 
 // 发送消息
-bool RaftCore::sendMessage(int target_id, const Message& message) {
+bool RaftCore::sendMessage(int target_id, Message& message) {
+    message.group_id = group_id_;
     if (send_message_callback_) {
         return send_message_callback_(target_id, message);
     }
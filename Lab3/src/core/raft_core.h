@@ -7,15 +7,20 @@
 #include <thread>
 #include <condition_variable>
 #include <functional>
+#include <future>
+#include <deque>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <chrono>
+#include <climits>
 #include <random>
 
 #include "../include/constants.h"
 #include "../storage/log_store.h"
 #include "../storage/kv_store.h"
+#include "../storage/snapshot_store.h"
 #include "../network/message.h"
 #include "../utils/tools.h"
 
@@ -38,6 +43,14 @@ public:
      * 回调函数类型定义
      */
     using SendMessageCallback = std::function<bool(int target_id, const Message& message)>;
+    // 安装快照回调：用快照数据恢复状态机，并把最后应用索引设为index
+    using InstallSnapshotCallback = std::function<bool(int index, int term, const std::string& data)>;
+    // 提交回调：提交索引推进后调用，用于唤醒日志应用线程
+    using CommitCallback = std::function<void(int commit_index)>;
+    // ReadIndex回调：给出读索引，-1表示无法确认
+    using ReadIndexCallback = std::function<void(int read_index)>;
+    // 提交等待回调：日志以写入时的任期提交为true，无法确认时为false
+    using CommitWaiterCallback = std::function<void(bool committed)>;
     
     /**
      * 构造函数
@@ -45,8 +58,11 @@ public:
      * @param cluster_size 集群大小（由上层根据配置文件节点数传入）
      * @param log_store 日志存储
      * @param kv_store KV存储
+     * @param snapshot_store 快照存储
+     * @param group_id 所属Raft组ID，发出的消息带上该ID
      */
-    RaftCore(int node_id, int cluster_size, LogStore* log_store, KVStore* kv_store);
+    RaftCore(int node_id, int cluster_size, LogStore* log_store, KVStore* kv_store, SnapshotStore* snapshot_store,
+             int group_id = 0);
     
     /**
      * 析构函数
@@ -78,6 +94,22 @@ public:
     void setSendMessageCallback(SendMessageCallback callback) {
         send_message_callback_ = callback;
     }
+
+    /**
+     * 设置安装快照回调
+     * @param callback 回调函数
+     */
+    void setInstallSnapshotCallback(InstallSnapshotCallback callback) {
+        install_snapshot_callback_ = callback;
+    }
+
+    /**
+     * 设置提交回调
+     * @param callback 回调函数
+     */
+    void setCommitCallback(CommitCallback callback) {
+        commit_callback_ = callback;
+    }
     
     /**
      * 获取当前状态
@@ -98,6 +130,12 @@ public:
      * @return Leader ID，如果没有Leader则返回0
      */
     int getLeaderId() const { return leader_id_; }
+
+    /**
+     * 获取最近一次当选leader时的任期
+     * @return 当选任期，从未当选时返回0
+     */
+    int getLeaderTerm() const { return leader_term_; }
     
     /**
      * 获取最后应用的日志索引
@@ -131,12 +169,27 @@ public:
     int nodeIdToIndex(int node_id) const;
     
     /**
-     * 添加日志条目
+     * 以leader身份添加日志条目，只有仍是term任期的leader时才会写入
      * @param command 命令内容
-     * @param term 任期
-     * @return 添加的日志索引
+     * @param term 任期（当选时的任期，见getLeaderTerm）
+     * @return 添加的日志索引，已不是该任期的leader时返回0
      */
     int appendLogEntry(const std::string& command, int term);
+
+    /**
+     * 注册提交等待：commit_index_推进到index时调用回调（不持有内部锁，可能在调用线程中直接调用）
+     * @param index 日志索引
+     * @param term 该日志写入时的任期
+     * @param callback 日志以该任期提交时参数为true；任期不符、失去leader身份或停止时为false
+     */
+    void waitForCommit(int index, int term, CommitWaiterCallback callback);
+
+    /**
+     * ReadIndex读：leader记录当前提交索引，并通过一轮心跳确认自己仍是leader，
+     * 同一轮心跳发出前到达的读请求共享这一轮确认；follower通过ReadIndex RPC向leader查询
+     * @return 确认后给出读索引，状态机应用到该索引后即可读取；无法确认时为-1
+     */
+    std::future<int> readIndex();
     
     /**
      * 检查节点是否为Leader
@@ -151,7 +204,7 @@ private:
     void mainLoop();
     
     /**
-     * Follower状态循环
+     * Follower状态循环：等待选举计时器到期，到期后先进行Pre-Vote
      */
     void followerLoop();
     
@@ -164,11 +217,72 @@ private:
      * Leader状态循环
      */
     void leaderLoop();
+
+    /**
+     * Pre-Vote：以下一任期询问其他节点能否当选，不增加任期，避免被隔离的节点回来后打断现任leader
+     * @return 是否得到多数派同意
+     */
+    bool preVote();
+
+    /**
+     * 随机的选举超时时间（多组时非首选节点更长一些）
+     */
+    std::chrono::milliseconds randomElectionTimeout();
+
+    /**
+     * 重置选举计时器
+     */
+    void resetElectionTimer();
+
+    /**
+     * 收到当前leader的消息：记录联系时间并重置选举计时器
+     */
+    void touchLeader();
+
+    /**
+     * 最近一个最小选举超时内是否收到过leader的消息
+     */
+    bool leaderRecentlyActive();
+
+    /**
+     * 唤醒等待选举计时器或投票结果的线程
+     */
+    void notifyTimer();
+
+    /**
+     * leader在最近一个最大选举超时内是否与多数派保持联系
+     */
+    bool hasQuorumContact();
     
     /**
      * 日志应用循环
      */
     // void logApplierLoop(); // 日志应用功能已移至RaftNode
+
+    /**
+     * 复制线程循环，每个follower一个线程：有新日志且窗口未满时立即发送，空闲时发送心跳
+     * @param peer_id 目标节点ID
+     */
+    void replicatorLoop(int peer_id);
+
+    /**
+     * 是否有需要立即发送给某个follower的日志，调用者需持有match_mutex_
+     * @param idx follower在内部数组中的索引
+     * @param now 当前时间
+     */
+    bool hasReplicationWork(int idx, std::chrono::steady_clock::time_point now);
+
+    /**
+     * 唤醒所有复制线程
+     */
+    void notifyReplicators();
+
+    /**
+     * 在本地日志中查找任期不超过term的最后一条日志（任期随索引单调不减，二分查找）
+     * @param term 任期
+     * @return 日志索引；快照之后没有这样的日志时返回快照索引
+     */
+    int lastIndexUpToTerm(int term) const;
     
     
     /**
@@ -194,6 +308,11 @@ private:
      * 成为候选人
      */
     void becomeCandidate();
+
+    /**
+     * 持久化当前任期和投票对象，必须在回应投票/发起选举前调用
+     */
+    void persistHardState();
     
     /**
      * 处理RequestVote请求
@@ -224,12 +343,79 @@ private:
      * @param response 响应消息
      */
     void handleAppendEntriesResponse(int from_node_id, const AppendEntriesResponse& response);
+
+    /**
+     * 处理InstallSnapshot请求
+     * @param from_node_id 发送者节点ID
+     * @param request 请求消息
+     * @return 响应消息
+     */
+    std::unique_ptr<Message> handleInstallSnapshot(int from_node_id, const InstallSnapshotRequest& request);
+
+    /**
+     * 处理InstallSnapshot响应
+     * @param from_node_id 发送者节点ID
+     * @param response 响应消息
+     */
+    void handleInstallSnapshotResponse(int from_node_id, const InstallSnapshotResponse& response);
     
     
     /**
      * 更新提交索引
      */
     void updateCommitIndex();
+
+    /**
+     * 推进提交索引并完成已到达的提交等待
+     * @param index 新的提交索引
+     */
+    void advanceCommitIndex(int index);
+
+    /**
+     * 以失败结束所有提交等待（失去leader身份或停止时调用）
+     */
+    void failCommitWaiters();
+
+    /**
+     * leader上登记一个ReadIndex读，确认后调用回调
+     * @param callback 回调函数
+     */
+    void readIndexLocal(ReadIndexCallback callback);
+
+    /**
+     * 处理ReadIndex请求（leader）
+     * @param from_node_id 发送者节点ID
+     * @param request 请求消息
+     */
+    void handleReadIndexRequest(int from_node_id, const ReadIndexRequest& request);
+
+    /**
+     * 处理ReadIndex响应（follower）
+     * @param from_node_id 发送者节点ID
+     * @param response 响应消息
+     */
+    void handleReadIndexResponse(int from_node_id, const ReadIndexResponse& response);
+
+    /**
+     * 多数派已确认的心跳序列号达到要求后，完成等待中的ReadIndex读
+     */
+    void confirmReads();
+
+    /**
+     * 以失败结束所有ReadIndex读（失去leader身份或停止时调用）
+     */
+    void failReads();
+
+    /**
+     * 本地日志持久化后，向leader发送已满足的AppendEntries确认（follower）
+     */
+    void sendDurableAcks();
+
+    /**
+     * 丢弃确认索引不小于from_index的等待确认
+     * @param from_index 被截断的第一条日志索引，0表示全部丢弃
+     */
+    void dropPendingAcks(int from_index);
     
     /**
      * 发送RequestVote请求到指定节点
@@ -239,10 +425,18 @@ private:
     
     /**
      * 发送AppendEntries请求到指定节点
+     * 非心跳请求从nextIndex开始携带日志并推进nextIndex；心跳不带日志，从matchIndex处校验
      * @param target_id 目标节点ID
      * @param is_heartbeat 是否是心跳
      */
     void sendAppendEntries(int target_id, bool is_heartbeat = false);
+
+    /**
+     * 发送InstallSnapshot请求到指定节点（该节点需要的日志已被压缩）
+     * @param target_id 目标节点ID
+     * @return 是否发送成功
+     */
+    bool sendInstallSnapshot(int target_id);
     
     /**
      * 发送消息
@@ -250,27 +444,38 @@ private:
      * @param message 消息
      * @return 是否发送成功
      */
-    bool sendMessage(int target_id, const Message& message);
+    bool sendMessage(int target_id, Message& message);
     
 private:
     // 基本信息
     int id_;                                    // 节点ID
     int cluster_size_;                          // 集群大小
+    int group_id_;                              // 所属Raft组ID
     
     // 组件指针
     LogStore* log_store_;                       // 日志存储
     KVStore* kv_store_;                         // KV存储
+    SnapshotStore* snapshot_store_;             // 快照存储
     
     // 状态
     std::atomic<NodeState> state_;              // 当前状态
     std::atomic<int> current_term_;             // 当前任期
     std::atomic<bool> voted_;                   // 是否已投票
+    std::atomic<int> voted_for_;                // 本任期投票给的节点ID
     std::atomic<int> vote_count_;               // 获得的票数
     std::atomic<int> leader_id_;                // 领导者ID
-    std::atomic<bool> received_heartbeat_;      // 是否收到心跳
+    std::atomic<int> leader_term_;              // 最近一次当选leader时的任期
     
     //领导选举相关
     std::mutex vote_mutex_;                    // 保护投票状态的互斥锁
+    std::atomic<int> pre_vote_term_;            // 正在进行的Pre-Vote所用的任期
+    std::atomic<int> pre_vote_count_;           // Pre-Vote获得的同意数
+
+    // 选举计时器（单调时钟）
+    std::mutex timer_mutex_;                    // 保护计时器状态
+    std::condition_variable timer_cv_;          // 计时器重置、状态变化或收到投票时唤醒
+    std::chrono::steady_clock::time_point election_deadline_; // 选举超时的时间点
+    std::chrono::steady_clock::time_point last_leader_contact_; // 最近一次收到leader消息的时间
     
     // 日志复制相关
     std::atomic<int> commit_index_;             // 已提交的日志索引
@@ -278,9 +483,58 @@ private:
     std::atomic<int> leader_commit_index_;      // 领导者的提交索引
     std::vector<int> match_index_;              // 每个节点已复制的最高日志索引
     std::vector<int> match_term_;               // 每个节点已复制的最高日志任期
-    std::mutex match_mutex_;                    // 保护match_index_和match_term_的互斥锁
+    std::vector<int> next_index_;               // 每个节点下一条要发送的日志索引
+    std::vector<int> inflight_;                 // 每个节点在途的AppendEntries数
+    std::vector<int> last_sent_seq_;            // 每个节点最近一次发送时的心跳序列号（本轮已发送过则不再单独发心跳）
+    std::vector<int> acked_seq_;                // 每个节点在本任期确认过的最大心跳序列号
+    std::vector<std::chrono::steady_clock::time_point> last_response_time_; // 最近一次收到响应的时间
+    std::vector<std::chrono::steady_clock::time_point> last_contact_time_; // 最近一次收到同任期响应的时间，用于检查多数派联系
+    std::vector<std::chrono::steady_clock::time_point> retry_after_;        // 发送失败后暂停到该时间
+    std::mutex match_mutex_;                    // 保护以上每个节点的复制状态
+    std::mutex commit_update_mutex_;            // 串行化leader提交索引的计算
+    std::mutex append_entries_mutex_;           // 串行化对本地日志的追加（follower的AppendEntries/InstallSnapshot和leader的appendLogEntry）
+
+    // 复制线程相关
+    std::vector<std::thread> replicator_threads_; // 每个follower一个复制线程
+    std::mutex replicate_mutex_;                // 配合replicate_cv_使用
+    std::condition_variable replicate_cv_;      // 有新日志或窗口空出时唤醒复制线程
     std::atomic<int> ack_;                      // 当前收到的确认号
     std::atomic<int> seq_;                      // 当前请求序列号
+
+    // 提交等待相关
+    struct CommitWaiter {
+        int term;                               // 日志写入时的任期
+        CommitWaiterCallback callback;          // 提交结果回调
+    };
+    std::multimap<int, CommitWaiter> commit_waiters_;  // 按日志索引排列的提交等待
+    std::mutex commit_waiter_mutex_;            // 保护commit_waiters_
+
+    // ReadIndex相关
+    struct PendingRead {
+        int seq;                                // 需要多数派确认的心跳序列号
+        int read_index;                         // 读索引
+        ReadIndexCallback callback;             // 确认结果回调
+    };
+    std::deque<PendingRead> pending_reads_;     // 按seq递增排列的待确认读请求（leader）
+    struct RemoteRead {
+        std::chrono::steady_clock::time_point deadline; // 超过该时间调用者已放弃等待
+        std::promise<int> promise;              // 读索引结果
+    };
+    std::map<uint64_t, RemoteRead> remote_reads_; // 按请求ID（即发出先后）排列的等待leader响应的读请求（follower）
+    uint64_t next_read_id_ = 0;                 // 下一个ReadIndex请求ID
+    std::mutex read_mutex_;                     // 保护pending_reads_和remote_reads_
+    std::atomic<int> noop_index_;               // 本任期开始时追加的空日志索引
+    static constexpr int NOOP_PENDING = INT_MAX; // 当选后空日志尚未追加，此时不能确定读索引
+
+    // 等待持久化的AppendEntries确认（follower）
+    struct PendingAck {
+        int leader_id;                          // 请求来自的leader
+        int index;                              // 持久化到该索引后确认
+        int term;                               // 收到请求时的任期
+        int seq;                                // 请求的心跳序列号
+    };
+    std::vector<PendingAck> pending_acks_;      // 尚未持久化、还没有回复的AppendEntries
+    std::mutex pending_ack_mutex_;              // 保护pending_acks_
     
     // 日志应用相关
     std::mutex log_apply_mutex_;                // 日志应用互斥锁
@@ -290,9 +544,6 @@ private:
     std::atomic<int> response_node_count_;      // 已响应的节点数
    
     
-    // 心跳相关
-    std::atomic<int> live_count_;               // 存活计数(避免网络分区)
-    
     // 线程相关
     std::atomic<bool> running_;                 // 是否运行中
     std::thread main_loop_thread_;              // 主循环线程
@@ -300,6 +551,8 @@ private:
     
     // 回调函数
     SendMessageCallback send_message_callback_; // 发送消息回调
+    InstallSnapshotCallback install_snapshot_callback_; // 安装快照回调
+    CommitCallback commit_callback_;            // 提交回调
 };
 
 } // namespace raft
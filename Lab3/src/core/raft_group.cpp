@@ -0,0 +1,680 @@
+#include "raft_group.h"
+#include "../utils/tools.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <charconv>
+
+namespace raft {
+
+// 解析日志中的整数参数（日志来自其他副本或旧版本，格式错误时不能抛出异常）
+static bool parseInt64(const std::string& text, int64_t& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+// 构造函数
+RaftGroup::RaftGroup(int node_id, int group_id, int cluster_size, const std::string& file_prefix,
+                     RaftCore::SendMessageCallback send_message)
+    : node_id_(node_id),
+      group_id_(group_id),
+      running_(false),
+      expiry_wheel_(EXPIRY_TICK_MS, currentTimeMs()),
+      eviction_pending_until_(0) {
+    // 创建日志存储（分段二进制日志）和快照存储
+    log_store_ = std::make_unique<SegmentedLogStore>(file_prefix + "_raft_log");
+    snapshot_store_ = std::make_unique<SnapshotStore>(file_prefix + "_snapshot.dat");
+
+    // 创建KV存储
+    kv_store_ = std::make_unique<KVStore>();
+
+    // 加载快照，使日志与快照对齐
+    loadSnapshot();
+
+    // 创建Raft核心（从日志存储恢复任期、投票和提交索引）
+    raft_core_ = std::make_unique<RaftCore>(node_id_, cluster_size, log_store_.get(), kv_store_.get(),
+                                            snapshot_store_.get(), group_id_);
+
+    // 重放快照之后已提交的日志
+    replayCommittedLog();
+
+    // 设置Raft核心的发送消息回调
+    raft_core_->setSendMessageCallback(send_message);
+
+    // 设置提交回调，唤醒日志应用线程
+    raft_core_->setCommitCallback([this](int) {
+        this->notifyCommit();
+    });
+
+    // 设置安装快照回调
+    raft_core_->setInstallSnapshotCallback([this](int index, int term, const std::string& data) -> bool {
+        return this->installSnapshot(index, term, data);
+    });
+}
+
+// 析构函数
+RaftGroup::~RaftGroup() {
+    stop();
+}
+
+// 启动本组
+void RaftGroup::start() {
+    if (running_) {
+        return;
+    }
+
+    // 启动日志应用线程
+    running_ = true;
+    log_apply_thread_ = std::thread([this]() {
+        logApplierLoop();
+    });
+
+    // 启动客户端命令合并线程
+    proposal_thread_ = std::thread([this]() {
+        proposalLoop();
+    });
+
+    // 启动维护线程
+    maintenance_thread_ = std::thread([this]() {
+        maintenanceLoop();
+    });
+
+    // 启动Raft核心
+    raft_core_->start();
+}
+
+// 停止本组
+void RaftGroup::stop() {
+    if (!running_) {
+        return;
+    }
+
+    running_ = false;
+    notifyCommit();
+    notifyApplied();
+    {
+        std::lock_guard<std::mutex> lock(proposal_mutex_);
+        proposal_cv_.notify_all();
+    }
+
+    // 停止Raft核心
+    raft_core_->stop();
+
+    // 等待日志应用线程、合并线程和维护线程结束
+    if (log_apply_thread_.joinable()) {
+        log_apply_thread_.join();
+    }
+    if (proposal_thread_.joinable()) {
+        proposal_thread_.join();
+    }
+    if (maintenance_thread_.joinable()) {
+        maintenance_thread_.join();
+    }
+
+    // 结束仍在等待应用结果的请求
+    std::lock_guard<std::mutex> lock(apply_waiter_mutex_);
+    for (auto& waiter : apply_waiters_) {
+        waiter.second->finish(nullptr);
+    }
+    apply_waiters_.clear();
+}
+
+// 处理发给本组的Raft消息
+std::unique_ptr<Message> RaftGroup::handleMessage(int from_node_id, const Message& message) {
+    return raft_core_->handleMessage(from_node_id, message);
+}
+
+// 处理命令应用到状态机
+std::string RaftGroup::applyCommand(KVStore::Batch& batch, const Command& command) {
+    // 根据命令类型执行操作
+    switch (command.type) {
+    case CommandType::GET: {
+        if (command.args.size() < 1) {
+            break;
+        }
+        // GET命令不会改变状态，在日志顺序上读取
+        std::string value;
+        if (!batch.get(command.args[0], value) || value.empty()) {
+            return "*1\r\n$3\r\nnil\r\n";
+        }
+        return RedisProtocol::encodeGetResponse(value);
+    }
+    case CommandType::SET:
+        if (command.args.size() < 2) {
+            break;
+        }
+        if (command.args.size() >= 3) {
+            // 带过期时间的SET
+            int64_t expire_at = 0;
+            if (!parseInt64(command.args[2], expire_at)) {
+                break;
+            }
+            batch.set(command.args[0], command.args[1], expire_at);
+            scheduleExpiry(command.args[0], expire_at);
+            return RedisProtocol::encodeStatus("OK");
+        }
+        // 设置键值，清除原有的过期时间
+        batch.set(command.args[0], command.args[1]);
+        return RedisProtocol::encodeStatus("OK");
+    case CommandType::DEL:
+        // 删除键
+        return RedisProtocol::encodeInteger(batch.multiDel(command.args));
+    case CommandType::MSET:
+        if (command.args.empty() || command.args.size() % 2 != 0) {
+            break;
+        }
+        // 一条日志中的全部键值一起生效
+        batch.multiSet(command.args);
+        return RedisProtocol::encodeStatus("OK");
+    case CommandType::EXPIRE: {
+        // 时间都取自命令，各副本结果一致
+        int64_t expire_at = 0;
+        int64_t now = 0;
+        if (command.args.size() < 3 || !parseInt64(command.args[1], expire_at) || !parseInt64(command.args[2], now)) {
+            break;
+        }
+        bool exists = batch.expire(command.args[0], expire_at, now);
+        if (exists && expire_at > now) {
+            scheduleExpiry(command.args[0], expire_at);
+        }
+        return RedisProtocol::encodeInteger(exists ? 1 : 0);
+    }
+    case CommandType::PERSIST: {
+        int64_t now = 0;
+        if (command.args.size() < 2 || !parseInt64(command.args[1], now)) {
+            break;
+        }
+        // 时间轮中留下的条目到期时发现键已没有过期时间，直接丢弃
+        return RedisProtocol::encodeInteger(batch.persist(command.args[0], now) ? 1 : 0);
+    }
+    case CommandType::EXPIRED: {
+        int64_t now = 0;
+        if (command.args.size() < 2 || !parseInt64(command.args[1], now)) {
+            break;
+        }
+        // 写入日志后键可能被重新设置或延长了过期时间，按leader写入时的时间再检查一次
+        return RedisProtocol::encodeInteger(batch.removeExpired(command.args[0], now) ? 1 : 0);
+    }
+    case CommandType::EVICT:
+        // leader选出的淘汰键，应用后leader可以选下一批
+        eviction_pending_until_ = 0;
+        return RedisProtocol::encodeInteger(batch.multiDel(command.args));
+    case CommandType::MGET:
+    case CommandType::EXISTS:
+    case CommandType::SCAN:
+    case CommandType::KEYS:
+    case CommandType::TTL:
+    case CommandType::PTTL:
+        // 只读命令不写日志，不会出现在这里
+        break;
+    }
+    
+    return RedisProtocol::encodeError("Protocol error");
+}
+
+// 应用一条（可能由多条命令合并而成的）日志
+std::vector<std::string> RaftGroup::applyEntry(KVStore::Batch& batch, const std::string& entry) {
+    std::vector<std::string> results;
+    Command& command = apply_command_;
+    
+    if (Command::isEncoded(entry)) {
+        // 二进制命令依次解码执行
+        BufferReader reader(entry.data(), entry.size());
+        while (reader.remaining() > 0) {
+            if (!command.decode(reader)) {
+                // 格式错误，无法定位后续命令
+                results.push_back(RedisProtocol::encodeError("Protocol error"));
+                break;
+            }
+            results.push_back(applyCommand(batch, command));
+        }
+        return results;
+    }
+    
+    // 旧版本写入的RESP格式日志
+    size_t pos = 0;
+    std::string error;
+    while (pos < entry.size()) {
+        std::vector<std::string> parsed = RedisProtocol::parseCommand(entry, pos);
+        if (parsed.empty()) {
+            // 格式错误，无法定位后续命令
+            results.push_back(RedisProtocol::encodeError("Protocol error"));
+            break;
+        }
+        // 旧版本日志中没有带过期时间的命令，不依赖当前时间
+        if (!Command::fromArgs(parsed, 0, command, error)) {
+            results.push_back(RedisProtocol::encodeError(error));
+            continue;
+        }
+        results.push_back(applyCommand(batch, command));
+    }
+    return results;
+}
+
+// 提交一条编码后的客户端命令
+std::future<std::string> RaftGroup::propose(const std::string& command) {
+    Proposal proposal;
+    proposal.command = command;
+    std::future<std::string> result = proposal.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(proposal_mutex_);
+        proposal_bytes_ += command.size();
+        proposals_.push_back(std::move(proposal));
+    }
+    proposal_cv_.notify_one();
+
+    // 响应由合并线程（未能写入日志）、提交失败回调或日志应用线程给出，调用者可以先继续提交后续命令
+    return result;
+}
+
+// 通过ReadIndex确认读索引并等待状态机应用到该位置
+bool RaftGroup::waitReadIndex() {
+    // follower上的读需要leader响应，leader失联时不能无限等待
+    std::future<int> future = raft_core_->readIndex();
+    if (future.wait_for(std::chrono::milliseconds(COMMAND_WAIT_TIMEOUT_MS)) != std::future_status::ready) {
+        return false;
+    }
+    int read_index = future.get();
+    return read_index >= 0 && waitApplied(read_index);
+}
+
+// 通过ReadIndex执行只读命令
+std::string RaftGroup::read(const Command& command) {
+    if (!waitReadIndex()) {
+        return "+TRYAGAIN\r\n";
+    }
+    
+    switch (command.type) {
+    case CommandType::GET:
+        return RedisProtocol::encodeGetResponse(kv_store_->get(command.args[0]));
+    case CommandType::MGET: {
+        // 一次取出所有键，不存在的键返回空值
+        std::vector<std::string> values = kv_store_->multiGet(command.args);
+        std::string response = "*" + std::to_string(values.size()) + "\r\n";
+        for (const auto& value : values) {
+            response += value.empty() ? RedisProtocol::encodeNull() : RedisProtocol::encode(value);
+        }
+        return response;
+    }
+    case CommandType::EXISTS:
+        return RedisProtocol::encodeInteger(kv_store_->countExisting(command.args));
+    case CommandType::TTL:
+    case CommandType::PTTL: {
+        // 键不存在返回-2，没有过期时间返回-1；TTL按秒四舍五入
+        int64_t ttl = kv_store_->ttlMs(command.args[0]);
+        if (ttl >= 0 && command.type == CommandType::TTL) {
+            ttl = (ttl + 500) / 1000;
+        }
+        return RedisProtocol::encodeInteger(ttl);
+    }
+    default:
+        return RedisProtocol::encodeError("Protocol error");
+    }
+}
+
+// 通过ReadIndex分页读取本组的键
+bool RaftGroup::scanKeys(const std::string& after, const std::string& prefix, size_t count, std::vector<std::string>& keys) {
+    if (!waitReadIndex()) {
+        return false;
+    }
+    keys = kv_store_->scan(after, prefix, count);
+    return true;
+}
+
+// 等待状态机应用到指定索引
+bool RaftGroup::waitApplied(int index) {
+    std::unique_lock<std::mutex> lock(applied_mutex_);
+    // follower与leader断开后提交索引不再推进，等待需要有上限
+    applied_cv_.wait_for(lock, std::chrono::milliseconds(COMMAND_WAIT_TIMEOUT_MS), [this, index]() {
+        return !running_ || raft_core_->getLastApplied() >= index;
+    });
+    return raft_core_->getLastApplied() >= index;
+}
+
+// 已应用索引推进时唤醒等待读取的请求
+void RaftGroup::notifyApplied() {
+    std::lock_guard<std::mutex> lock(applied_mutex_);
+    applied_cv_.notify_all();
+}
+
+// 合并线程主循环
+void RaftGroup::proposalLoop() {
+    while (running_) {
+        std::vector<Proposal> batch;
+        {
+            std::unique_lock<std::mutex> lock(proposal_mutex_);
+            proposal_cv_.wait(lock, [this]() { return !running_ || !proposals_.empty(); });
+            if (!running_) {
+                break;
+            }
+            // 等待一个短窗口，让并发到达的命令合并为一条日志
+            if (proposal_bytes_ < CLIENT_BATCH_MAX_BYTES) {
+                proposal_cv_.wait_for(lock, std::chrono::microseconds(CLIENT_BATCH_MAX_DELAY_US), [this]() {
+                    return !running_ || proposal_bytes_ >= CLIENT_BATCH_MAX_BYTES;
+                });
+            }
+            size_t bytes = 0;
+            while (!proposals_.empty() &&
+                   (batch.empty() || bytes + proposals_.front().command.size() <= CLIENT_BATCH_MAX_BYTES)) {
+                bytes += proposals_.front().command.size();
+                batch.push_back(std::move(proposals_.front()));
+                proposals_.pop_front();
+            }
+            proposal_bytes_ -= bytes;
+        }
+
+        if (!raft_core_->isLeader()) {
+            for (auto& proposal : batch) {
+                proposal.result.set_value("+TRYAGAIN\r\n");
+            }
+            continue;
+        }
+
+        // 拼接成一条日志，编码后的命令自带长度，应用时依次解码
+        std::string entry;
+        for (const auto& proposal : batch) {
+            entry += proposal.command;
+        }
+
+        // 添加到日志，同时登记应用结果等待（持锁保证日志应用线程不会先于登记应用该条目）
+        // 使用当选时的任期：检查leader身份之后可能已降级又进入了新任期，追加时会再次确认
+        auto waiter = std::make_shared<ApplyWaiter>();
+        waiter->term = raft_core_->getLeaderTerm();
+        for (auto& proposal : batch) {
+            waiter->results.push_back(std::move(proposal.result));
+        }
+        int index = 0;
+        {
+            std::lock_guard<std::mutex> lock(apply_waiter_mutex_);
+            index = raft_core_->appendLogEntry(entry, waiter->term);
+            if (index > 0) {
+                // 同一位置上之前任期的等待者所在日志已被覆盖
+                std::shared_ptr<ApplyWaiter>& slot = apply_waiters_[index];
+                if (slot) {
+                    slot->finish(nullptr);
+                }
+                slot = waiter;
+            }
+        }
+        if (index == 0) {
+            // 已不是该任期的leader，客户端重试
+            waiter->finish(nullptr);
+            continue;
+        }
+
+        // 失去leader身份或该位置被其他日志覆盖时无法确认命令是否生效，客户端重试；提交成功后由日志应用线程响应
+        raft_core_->waitForCommit(index, waiter->term, [waiter](bool committed) {
+            if (!committed) {
+                waiter->finish(nullptr);
+            }
+        });
+    }
+
+    // 结束尚未写入日志的命令
+    std::lock_guard<std::mutex> lock(proposal_mutex_);
+    for (auto& proposal : proposals_) {
+        proposal.result.set_value("+TRYAGAIN\r\n");
+    }
+    proposals_.clear();
+    proposal_bytes_ = 0;
+}
+
+// 维护线程主循环
+void RaftGroup::maintenanceLoop() {
+    while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(EXPIRY_TICK_MS));
+        int64_t now = currentTimeMs();
+        expireDueKeys(now);
+        evictIfNeeded(now);
+    }
+}
+
+// 处理时间轮中到期的键
+void RaftGroup::expireDueKeys(int64_t now) {
+    std::vector<std::string> due;
+    {
+        std::lock_guard<std::mutex> lock(expiry_mutex_);
+        expiry_wheel_.advance(now, [&due](const std::string& key, int64_t) {
+            due.push_back(key);
+        });
+    }
+    if (due.empty()) {
+        return;
+    }
+
+    bool leader = raft_core_->isLeader();
+    for (const auto& key : due) {
+        // 键已删除、已清除过期时间或过期时间被延长（延长时已加入新的条目），丢弃该条目
+        int64_t expire_at = kv_store_->expireAt(key);
+        if (expire_at < 0 || expire_at > now) {
+            continue;
+        }
+        if (leader) {
+            // 与客户端命令一起合并写入日志，不等待结果
+            Command command;
+            command.type = CommandType::EXPIRED;
+            command.args = {key, std::to_string(now)};
+            std::string encoded;
+            command.encode(encoded);
+            propose(encoded);
+        }
+        // 删除应用前再次检查：写入失败、失去leader身份或本节点是follower时由之后的leader删除
+        scheduleExpiry(key, now + EXPIRY_RETRY_MS);
+    }
+}
+
+// 超过内存上限时淘汰一批键
+void RaftGroup::evictIfNeeded(int64_t now) {
+    size_t max_memory = kv_store_->maxMemory();
+    if (max_memory == 0 || kv_store_->evictionPolicy() == EvictionPolicy::NOEVICTION ||
+        !raft_core_->isLeader() || now < eviction_pending_until_.load()) {
+        return;
+    }
+    size_t used = kv_store_->usedMemory();
+    if (used <= max_memory) {
+        return;
+    }
+
+    // 选出的键由各副本在日志的同一位置删除，状态机保持一致
+    Command command;
+    command.type = CommandType::EVICT;
+    command.args = kv_store_->evictionCandidates(used - max_memory, EVICTION_MAX_KEYS);
+    if (command.args.empty()) {
+        return;
+    }
+    std::string encoded;
+    command.encode(encoded);
+    eviction_pending_until_ = now + EXPIRY_RETRY_MS;
+    propose(encoded);
+}
+
+// 把键的过期时间加入时间轮
+void RaftGroup::scheduleExpiry(const std::string& key, int64_t expire_at) {
+    std::lock_guard<std::mutex> lock(expiry_mutex_);
+    expiry_wheel_.add(key, expire_at);
+}
+
+// 按状态机中的过期时间重建时间轮
+void RaftGroup::rebuildExpiryWheel() {
+    std::lock_guard<std::mutex> lock(expiry_mutex_);
+    expiry_wheel_.clear(currentTimeMs());
+    kv_store_->forEachExpiry([this](const std::string& key, int64_t expire_at) {
+        expiry_wheel_.add(key, expire_at);
+    });
+}
+
+// 日志应用线程主循环
+void RaftGroup::logApplierLoop() {
+    std::cout << "LogApplier thread started, group " << group_id_ << std::endl;
+    while (running_) {
+        {
+            // 等待提交索引超过已应用索引
+            std::unique_lock<std::mutex> lock(commit_mutex_);
+            commit_cv_.wait(lock, [this]() {
+                return !running_ || raft_core_->getLastApplied() < raft_core_->getCommitIndex();
+            });
+        }
+        if (!running_) {
+            break;
+        }
+        applyCommitted();
+    }
+    std::cout << "LogApplier thread stopped, group " << group_id_ << std::endl;
+}
+
+// 把一段连续的已提交日志应用到状态机
+void RaftGroup::applyCommitted() {
+    std::lock_guard<std::mutex> lock(apply_mutex_);
+    // 加锁后读取，期间可能已安装了快照
+    int last_applied = raft_core_->getLastApplied();
+    int end = std::min(raft_core_->getCommitIndex(), last_applied + MAX_APPLY_BATCH);
+    if (last_applied >= end) {
+        return;
+    }
+
+    // 安装快照跳过的日志不会逐条应用，其上的等待者无法确认命令是否生效
+    {
+        std::lock_guard<std::mutex> waiter_lock(apply_waiter_mutex_);
+        auto skipped = apply_waiters_.upper_bound(last_applied);
+        for (auto it = apply_waiters_.begin(); it != skipped; ++it) {
+            it->second->finish(nullptr);
+        }
+        apply_waiters_.erase(apply_waiters_.begin(), skipped);
+    }
+
+    // 先占位再应用：一条日志中途抛出异常时，其中已执行的命令不能撤销，
+    // 这条日志也算作已应用（等待者收到错误），不能在下一轮重复执行
+    std::vector<std::vector<std::string>> results;
+    std::vector<int> terms;
+    results.reserve(end - last_applied);
+    terms.reserve(end - last_applied);
+    try {
+        kv_store_->apply([&](KVStore::Batch& batch) {
+            for (int i = last_applied + 1; i <= end; ++i) {
+                terms.push_back(log_store_->term_at(i));
+                results.emplace_back();
+                results.back() = applyEntry(batch, log_store_->entry_at(i));
+            }
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "[RaftGroup:] " << "Node(" << node_id_ << ") Group(" << group_id_ << ")应用日志失败: " << e.what() << std::endl;
+    }
+    if (results.empty()) {
+        return;
+    }
+
+    // 更新已应用索引，再把结果交给等待的客户端
+    int applied = last_applied + static_cast<int>(results.size());
+    raft_core_->setLastApplied(applied);
+    notifyApplied();
+    for (size_t i = 0; i < results.size(); ++i) {
+        completeApplyWaiter(last_applied + 1 + static_cast<int>(i), terms[i], results[i]);
+    }
+    maybeTakeSnapshot();
+}
+
+// 提交索引推进时唤醒日志应用线程
+void RaftGroup::notifyCommit() {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    commit_cv_.notify_one();
+}
+
+// 结束某个日志索引上的应用结果等待
+void RaftGroup::completeApplyWaiter(int index, int term, const std::vector<std::string>& results) {
+    std::shared_ptr<ApplyWaiter> waiter;
+    {
+        std::lock_guard<std::mutex> lock(apply_waiter_mutex_);
+        auto it = apply_waiters_.find(index);
+        if (it == apply_waiters_.end()) {
+            return;
+        }
+        waiter = std::move(it->second);
+        apply_waiters_.erase(it);
+    }
+    waiter->finish(waiter->term == term ? &results : nullptr);
+}
+
+// 给出一条日志上合并的各命令的响应
+void RaftGroup::ApplyWaiter::finish(const std::vector<std::string>* applied) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (done) {
+        return;
+    }
+    done = true;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (!applied) {
+            results[i].set_value("+TRYAGAIN\r\n");
+        } else {
+            results[i].set_value(i < applied->size() ? (*applied)[i] : RedisProtocol::encodeError("Protocol error"));
+        }
+    }
+}
+
+// 启动时加载快照
+void RaftGroup::loadSnapshot() {
+    auto start = std::chrono::steady_clock::now();
+    bool loaded = snapshot_store_->load([this](const char* data, size_t size) {
+        return kv_store_->restore(data, size);
+    });
+    if (!loaded) {
+        return;
+    }
+    int index = snapshot_store_->last_included_index();
+    log_store_->compact(index, snapshot_store_->last_included_term());
+    rebuildExpiryWheel();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "[RaftGroup:] " << "Node(" << node_id_ << ") Group(" << group_id_ << ")加载快照, index=" << index
+              << ", 耗时" << elapsed.count() << "ms" << std::endl;
+}
+
+// 启动时重放快照之后已提交的日志
+void RaftGroup::replayCommittedLog() {
+    auto start = std::chrono::steady_clock::now();
+    int last_applied = raft_core_->getLastApplied();
+    int commit_index = raft_core_->getCommitIndex();
+    kv_store_->apply([&](KVStore::Batch& batch) {
+        for (int i = last_applied + 1; i <= commit_index; ++i) {
+            applyEntry(batch, log_store_->entry_at(i));
+        }
+    });
+    if (commit_index > last_applied) {
+        raft_core_->setLastApplied(commit_index);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "[RaftGroup:] " << "Node(" << node_id_ << ") Group(" << group_id_ << ")重放日志(" << last_applied + 1 << ", "
+                  << commit_index << "), 耗时" << elapsed.count() << "ms" << std::endl;
+    }
+}
+
+// 已应用日志超过阈值时生成快照并压缩日志
+void RaftGroup::maybeTakeSnapshot() {
+    int last_applied = raft_core_->getLastApplied();
+    if (last_applied - snapshot_store_->last_included_index() < SNAPSHOT_LOG_THRESHOLD) {
+        return;
+    }
+    int term = log_store_->term_at(last_applied);
+    // 持有apply_mutex_，状态机与last_applied一致
+    if (snapshot_store_->save(last_applied, term, kv_store_->snapshot())) {
+        log_store_->compact(last_applied, term);
+        std::cout << "[RaftGroup:] " << "Node(" << node_id_ << ") Group(" << group_id_ << ")生成快照, index=" << last_applied << std::endl;
+    }
+}
+
+// 用leader发来的快照恢复状态机
+bool RaftGroup::installSnapshot(int index, int term, const std::string& data) {
+    std::lock_guard<std::mutex> lock(apply_mutex_);
+    if (index <= raft_core_->getLastApplied()) {
+        return true;
+    }
+    if (!kv_store_->restore(data)) {
+        std::cerr << "[RaftGroup:] " << "Node(" << node_id_ << ") Group(" << group_id_ << ")快照数据损坏, index=" << index << std::endl;
+        return false;
+    }
+    rebuildExpiryWheel();
+    raft_core_->setLastApplied(index);
+    notifyApplied();
+    std::cout << "[RaftGroup:] " << "Node(" << node_id_ << ") Group(" << group_id_ << ")安装快照, index=" << index << ", term=" << term << std::endl;
+    return true;
+}
+
+} // namespace raft
@@ -0,0 +1,293 @@
+#ifndef RAFT_GROUP_H
+#define RAFT_GROUP_H
+
+#include "../core/raft_core.h"
+#include "../storage/kv_store.h"
+#include "../storage/log_store.h"
+#include "../storage/segmented_log_store.h"
+#include "../storage/snapshot_store.h"
+#include "../utils/redis_protocol.h"
+#include "../utils/command.h"
+#include "../utils/timing_wheel.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <map>
+
+namespace raft {
+
+/**
+ * RaftGroup类 - 一个Raft组，负责键空间中的一个分区
+ * 包括该组的日志、快照、状态机、RaftCore，以及日志应用线程、客户端命令合并线程和后台维护线程（键过期和内存淘汰）
+ * 同一进程中的多个RaftGroup共享RaftNode的网络连接，消息按组ID分发
+ */
+class RaftGroup {
+public:
+    /**
+     * 构造函数
+     * @param node_id 本节点ID
+     * @param group_id 组ID
+     * @param cluster_size 集群节点数
+     * @param file_prefix 日志和快照文件名前缀
+     * @param send_message 发送Raft消息的回调
+     */
+    RaftGroup(int node_id, int group_id, int cluster_size, const std::string& file_prefix,
+              RaftCore::SendMessageCallback send_message);
+
+    /**
+     * 析构函数，清理资源
+     */
+    ~RaftGroup();
+
+    /**
+     * 启动日志应用线程、合并线程、维护线程和RaftCore
+     */
+    void start();
+
+    /**
+     * 停止所有线程，结束等待中的请求
+     */
+    void stop();
+
+    /**
+     * 处理发给本组的Raft消息
+     */
+    std::unique_ptr<Message> handleMessage(int from_node_id, const Message& message);
+
+    /**
+     * 获取本组中本节点的状态
+     */
+    NodeState getState() const { return raft_core_->getState(); }
+
+    /**
+     * 获取本组的leader ID，未知时为0
+     */
+    int getLeaderId() const { return raft_core_->getLeaderId(); }
+
+    /**
+     * 提交一条客户端命令，与同一窗口内的其他命令合并写入日志；按提交顺序写入日志，不等待应用即返回
+     * @param command 以Command::encode编码的命令
+     * @return 返回给客户端的响应，命令应用后（或确认无法生效、需要重试时）就绪，可以不阻塞地查询
+     */
+    std::future<std::string> propose(const std::string& command);
+
+    /**
+     * 设置本组状态机的内存上限和淘汰策略，在start之前调用
+     * @param max_bytes 内存上限（字节），0表示不限制
+     * @param policy 淘汰策略
+     */
+    void setMemoryLimit(size_t max_bytes, EvictionPolicy policy) { kv_store_->setMemoryLimit(max_bytes, policy); }
+
+    /**
+     * 超过内存上限且淘汰策略为不淘汰时，拒绝会增加内存的写入
+     */
+    bool rejectsWrites() const {
+        return kv_store_->evictionPolicy() == EvictionPolicy::NOEVICTION && kv_store_->maxMemory() > 0 &&
+               kv_store_->usedMemory() > kv_store_->maxMemory();
+    }
+
+    /**
+     * 通过ReadIndex执行只读命令（GET/MGET/EXISTS/TTL/PTTL），不写日志
+     * @param command 只读命令
+     * @return 返回给客户端的响应
+     */
+    std::string read(const Command& command);
+
+    /**
+     * 通过ReadIndex按字典序分页读取本组的键
+     * @param after 只返回大于该键的键，为空时从头开始
+     * @param prefix 键前缀
+     * @param count 最多返回的键数
+     * @param keys 输出的键，按字典序排列
+     * @return 是否读取成功（无法确认读索引时返回false）
+     */
+    bool scanKeys(const std::string& after, const std::string& prefix, size_t count, std::vector<std::string>& keys);
+
+private:
+    /**
+     * 处理命令应用到状态机
+     * @param batch 状态机的批量操作视图
+     * @param command 解码后的命令
+     * @return 返回给客户端的响应
+     */
+    std::string applyCommand(KVStore::Batch& batch, const Command& command);
+
+    /**
+     * 应用一条日志，日志内容是一条或多条拼接在一起的编码命令（旧版本日志为RESP命令）
+     * @param batch 状态机的批量操作视图
+     * @param entry 日志内容
+     * @return 每条命令的响应
+     */
+    std::vector<std::string> applyEntry(KVStore::Batch& batch, const std::string& entry);
+
+    /**
+     * 合并线程主循环：把短时间内到达的命令合并为一条日志
+     */
+    void proposalLoop();
+
+    /**
+     * 维护线程主循环：每个tick处理到期的键，并检查内存上限
+     */
+    void maintenanceLoop();
+
+    /**
+     * 推进时间轮，leader把到期的键作为EXPIRED命令写入日志
+     * 时间轮在每个副本上都由日志应用线程维护，切换leader后新leader直接接手
+     * @param now 当前时间(ms)
+     */
+    void expireDueKeys(int64_t now);
+
+    /**
+     * leader超过内存上限时按淘汰策略选出一批键，作为EVICT命令写入日志，各副本应用时删除
+     * 上一批淘汰应用之前不再选新的一批，避免重复淘汰；写入失败时隔EXPIRY_RETRY_MS重试
+     * @param now 当前时间(ms)
+     */
+    void evictIfNeeded(int64_t now);
+
+    /**
+     * 把键的过期时间加入时间轮
+     */
+    void scheduleExpiry(const std::string& key, int64_t expire_at);
+
+    /**
+     * 按状态机中的过期时间重建时间轮，在加载或安装快照后调用
+     */
+    void rebuildExpiryWheel();
+
+    /**
+     * 通过ReadIndex确认读索引并等待状态机应用到该位置
+     * @return 是否可以在本地读取（无法联系leader或等待超时时返回false）
+     */
+    bool waitReadIndex();
+
+    /**
+     * 等待状态机应用到指定索引
+     * @param index 日志索引
+     * @return 是否已应用到该索引（停止或等待超时时返回false）
+     */
+    bool waitApplied(int index);
+
+    /**
+     * 已应用索引推进时唤醒等待读取的请求
+     */
+    void notifyApplied();
+
+    /**
+     * 日志应用线程主循环
+     * 由提交回调唤醒，负责将已提交的日志应用到状态机
+     */
+    void logApplierLoop();
+
+    /**
+     * 把一段连续的已提交日志在一次调用内应用到状态机，并把结果交给等待的客户端
+     */
+    void applyCommitted();
+
+    /**
+     * 提交索引推进时唤醒日志应用线程
+     */
+    void notifyCommit();
+
+    /**
+     * 结束某个日志索引上的应用结果等待
+     * @param index 日志索引
+     * @param term 应用的日志的任期，与等待者写入时的任期不同说明该位置已被其他日志覆盖
+     * @param results 该日志中每条命令的结果
+     */
+    void completeApplyWaiter(int index, int term, const std::vector<std::string>& results);
+
+    /**
+     * 启动时加载快照到状态机，并按快照压缩日志
+     */
+    void loadSnapshot();
+
+    /**
+     * 启动时把快照之后、已知已提交的日志批量应用到状态机
+     */
+    void replayCommittedLog();
+
+    /**
+     * 已应用日志超过阈值时生成快照并压缩日志，调用者需持有apply_mutex_
+     */
+    void maybeTakeSnapshot();
+
+    /**
+     * 用leader发来的快照恢复状态机
+     * @param index 快照覆盖的最后一条日志索引
+     * @param term 该日志的任期
+     * @param data 快照数据
+     * @return 是否恢复成功
+     */
+    bool installSnapshot(int index, int term, const std::string& data);
+
+private:
+    // 基本信息
+    int node_id_;                                    // 节点ID
+    int group_id_;                                   // 组ID
+
+    // 核心组件
+    std::unique_ptr<LogStore> log_store_;            // 日志存储
+    std::unique_ptr<KVStore> kv_store_;              // KV存储
+    std::unique_ptr<SnapshotStore> snapshot_store_;  // 快照存储
+    std::unique_ptr<RaftCore> raft_core_;            // Raft核心
+
+    // 状态标记
+    std::atomic<bool> running_;                      // 运行标志
+
+    // 线程
+    std::thread log_apply_thread_;                   // 日志应用线程
+
+    // 互斥锁
+    std::mutex apply_mutex_;                         // 应用互斥锁
+    Command apply_command_;                          // 应用日志时复用的解码结果，持有apply_mutex_或启动重放时使用
+
+    // 日志应用唤醒
+    std::mutex commit_mutex_;                        // 配合commit_cv_使用
+    std::condition_variable commit_cv_;              // 提交索引推进时通知日志应用线程
+    std::mutex applied_mutex_;                       // 配合applied_cv_使用
+    std::condition_variable applied_cv_;             // 已应用索引推进时通知等待读取的请求
+
+    // 应用结果等待（leader上等待自己追加的日志被应用的客户端请求，按命令在日志中的顺序排列）
+    // 提交失败回调和日志应用线程都可能给出响应，先到的生效
+    struct ApplyWaiter {
+        int term = 0;                                // 日志写入时的任期
+        bool done = false;                           // 是否已给出响应
+        std::vector<std::promise<std::string>> results; // 每条命令的响应
+        std::mutex mutex;                            // 保护done
+
+        /**
+         * 给出响应，已给出时忽略
+         * @param applied 每条命令的应用结果，为空指针时全部响应TRYAGAIN
+         */
+        void finish(const std::vector<std::string>* applied);
+    };
+    std::map<int, std::shared_ptr<ApplyWaiter>> apply_waiters_;
+    std::mutex apply_waiter_mutex_;                  // 保护apply_waiters_
+
+    // 待合并写入日志的客户端命令
+    struct Proposal {
+        std::string command;                         // 编码后的命令
+        std::promise<std::string> result;            // 响应：应用结果，无法确认生效时为TRYAGAIN
+    };
+    std::deque<Proposal> proposals_;                 // 待合并的命令
+    size_t proposal_bytes_ = 0;                      // 待合并命令的总字节数
+    std::mutex proposal_mutex_;                      // 保护proposals_
+    std::condition_variable proposal_cv_;            // 有新命令时唤醒合并线程
+    std::thread proposal_thread_;                    // 合并线程
+
+    // 键过期与内存淘汰
+    TimingWheel expiry_wheel_;                       // 设置了过期时间的键，按过期时间分格
+    std::mutex expiry_mutex_;                        // 保护expiry_wheel_
+    std::atomic<int64_t> eviction_pending_until_;    // 已写入日志的淘汰在该时间(ms)前视为进行中，应用后清零
+    std::thread maintenance_thread_;                 // 维护线程
+};
+
+} // namespace raft
+
+#endif // RAFT_GROUP_H
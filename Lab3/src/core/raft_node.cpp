@@ -8,6 +8,7 @@
 #include <chrono>
 #include <regex>
 #include <algorithm>
+#include <cctype>
 
 namespace raft {
 
@@ -37,6 +38,7 @@ RaftNode::RaftNode(const std::string& config_path, const std::string& log_dir)
     if (node_id_ == 0) {
         throw std::runtime_error("无法从配置文件第一行解析出节点ID，或节点ID为0");
     }
+    parseMemoryConfig();
     
     // 初始化组件
     if (!initComponents()) {
@@ -62,16 +64,13 @@ void RaftNode::Run() {
         return;
     }
     
-    // 启动日志应用线程
+    // 启动各个Raft组
     running_ = true;
-    log_apply_thread_ = std::thread([this]() {
-        logApplierLoop();
-    });
-    
-    // 启动Raft核心
-    raft_core_->start();
+    for (auto& group : groups_) {
+        group->start();
+    }
     
-    std::cout << "RaftNode started" << std::endl;
+    std::cout << "RaftNode started with " << groups_.size() << " raft group(s)" << std::endl;
 }
 
 // 停止节点服务
@@ -82,9 +81,9 @@ void RaftNode::Stop() {
     
     running_ = false;
     
-    // 停止Raft核心
-    if (raft_core_) {
-        raft_core_->stop();
+    // 停止各个Raft组
+    for (auto& group : groups_) {
+        group->stop();
     }
     
     // 停止网络管理器
@@ -92,14 +91,62 @@ void RaftNode::Stop() {
         network_manager_->stop();
     }
     
-    // 等待日志应用线程结束
-    if (log_apply_thread_.joinable()) {
-        log_apply_thread_.join();
-    }
-    
     std::cout << "RaftNode stopped" << std::endl;
 }
 
+// 解析带单位的内存大小，如"100mb"
+static bool parseMemorySize(const std::string& text, size_t& bytes) {
+    size_t used = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &used);
+    } catch (const std::exception&) {
+        return false;
+    }
+    std::string unit = text.substr(used);
+    std::transform(unit.begin(), unit.end(), unit.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (unit.empty() || unit == "b") {
+        bytes = value;
+    } else if (unit == "kb" || unit == "k") {
+        bytes = value << 10;
+    } else if (unit == "mb" || unit == "m") {
+        bytes = value << 20;
+    } else if (unit == "gb" || unit == "g") {
+        bytes = value << 30;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 解析内存上限和淘汰策略
+void RaftNode::parseMemoryConfig() {
+    std::ifstream conf(config_path_);
+    std::string line;
+    while (std::getline(conf, line)) {
+        std::istringstream fields(line);
+        std::string name, value;
+        if (!(fields >> name >> value) || name[0] == '#') {
+            continue;
+        }
+        if (name == "maxmemory") {
+            if (!parseMemorySize(value, max_memory_)) {
+                throw std::runtime_error("无法解析maxmemory: " + value);
+            }
+        } else if (name == "maxmemory-policy") {
+            if (value == "noeviction") {
+                eviction_policy_ = EvictionPolicy::NOEVICTION;
+            } else if (value == "allkeys-lru") {
+                eviction_policy_ = EvictionPolicy::ALLKEYS_LRU;
+            } else if (value == "allkeys-lfu") {
+                eviction_policy_ = EvictionPolicy::ALLKEYS_LFU;
+            } else {
+                throw std::runtime_error("未知的maxmemory-policy: " + value);
+            }
+        }
+    }
+}
+
 // 初始化组件
 bool RaftNode::initComponents() {
     try {
@@ -107,33 +154,30 @@ bool RaftNode::initComponents() {
         network_manager_ = std::make_unique<NetworkManager>(node_id_, config_path_);
         int cluster_size = network_manager_->getClusterSize();
         
-        // 创建日志存储
-        std::string log_filename;
-        if (log_dir_.empty()) {
-            log_filename = "node_" + std::to_string(node_id_) + "_raft_log.dat";
-        } else {
-            log_filename = log_dir_ + "/node_" + std::to_string(node_id_) + "_raft_log.dat";
+        // 创建各个Raft组，组0沿用单组时的文件名
+        for (int group_id = 0; group_id < RAFT_GROUP_COUNT; ++group_id) {
+            std::string file_prefix = "node_" + std::to_string(node_id_);
+            if (group_id > 0) {
+                file_prefix += "_g" + std::to_string(group_id);
+            }
+            if (!log_dir_.empty()) {
+                file_prefix = log_dir_ + "/" + file_prefix;
+            }
+            groups_.push_back(std::make_unique<RaftGroup>(node_id_, group_id, cluster_size, file_prefix,
+                [this](int target_id, const Message& message) -> bool {
+                    return network_manager_->sendMessage(target_id, message);
+                }));
+            groups_.back()->setMemoryLimit(max_memory_ / RAFT_GROUP_COUNT, eviction_policy_);
         }
-        log_store_ = std::make_unique<InMemoryLogStore>(log_filename);
-        
-        // 创建KV存储
-        kv_store_ = std::make_unique<KVStore>();
-        
-        // 创建Raft核心
-        raft_core_ = std::make_unique<RaftCore>(node_id_, cluster_size, log_store_.get(), kv_store_.get());
         
         // 设置网络回调
         network_manager_->setMessageCallback([this](int from_node_id, const Message& message) -> std::unique_ptr<Message> {
             return this->handleMessage(from_node_id, message);
         });
         
-        network_manager_->setClientRequestCallback([this](int client_fd, const std::string& request) -> std::string {
-            return this->handleClientRequest(client_fd, request);
-        });
-        
-        // 设置Raft核心的发送消息回调
-        raft_core_->setSendMessageCallback([this](int target_id, const Message& message) -> bool {
-            return network_manager_->sendMessage(target_id, message);
+        network_manager_->setClientRequestCallback([this](int client_fd, const std::string& request,
+                                                          const std::function<void()>& wait_previous) {
+            return this->handleClientRequest(client_fd, request, wait_previous);
         });
         
         return true;
@@ -145,189 +189,147 @@ bool RaftNode::initComponents() {
 
 // 处理网络收到的消息回调
 std::unique_ptr<Message> RaftNode::handleMessage(int from_node_id, const Message& message) {
-    // 其他消息直接交给RaftCore处理
-    return raft_core_->handleMessage(from_node_id, message);
+    // 按组ID交给对应的Raft组处理
+    if (message.group_id < 0 || message.group_id >= static_cast<int>(groups_.size())) {
+        std::cerr << "[RaftNode:] " << "收到未知Raft组的消息, group=" << message.group_id << std::endl;
+        return nullptr;
+    }
+    return groups_[message.group_id]->handleMessage(from_node_id, message);
+}
+
+// 键所属的Raft组
+int RaftNode::groupOf(const std::string& key) const {
+    return static_cast<int>(std::hash<std::string>{}(key) % groups_.size());
 }
 
 
 // 处理客户端请求回调
-std::string RaftNode::handleClientRequest(int client_fd, const std::string& request) {
-    // 解析客户端请求
-    std::string command = request;
-    // 如果是RESP协议格式，解析命令
-    if (!command.empty() && command[0] == '*') {
-        std::vector<std::string> parsed = RedisProtocol::parseCommand(command);
-        if (parsed.empty()) {
-            return RedisProtocol::encodeError("Protocol error");
-        }
-        // 调用专门处理RESP命令的方法
-        return handleRespCommand(client_fd, parsed, command);
+std::future<std::string> RaftNode::handleClientRequest(int client_fd, const std::string& request,
+                                                       const std::function<void()>& wait_previous) {
+    // 只接受RESP数组格式的请求，解析一次后以结构化命令处理
+    if (request.empty() || request[0] != '*') {
+        return makeReadyResponse(RedisProtocol::encodeError("Protocol error"));
     }
-    // 非RESP协议格式或解析错误
-    return RedisProtocol::encodeError("Protocol error");
+    std::vector<std::string> parsed = RedisProtocol::parseCommand(request);
+    if (parsed.empty()) {
+        return makeReadyResponse(RedisProtocol::encodeError("Protocol error"));
+    }
+    
+    // 参数检查，不合法的命令不写入日志
+    Command command;
+    std::string error;
+    if (!Command::fromArgs(parsed, currentTimeMs(), command, error)) {
+        return makeReadyResponse(RedisProtocol::encodeError(error));
+    }
+    return handleCommand(client_fd, command, wait_previous);
 }
 
-// 处理RESP格式的客户端请求
-std::string RaftNode::handleRespCommand(int client_fd, const std::vector<std::string>& command, const std::string& original_request) {
-    // 检查节点状态
-    NodeState state = raft_core_->getState();
-    int leader_id = raft_core_->getLeaderId();
+// 处理解析后的客户端命令
+std::future<std::string> RaftNode::handleCommand(int client_fd, const Command& command,
+                                                 const std::function<void()>& wait_previous) {
+    (void)client_fd;
+
+    // SCAN/KEYS遍历所有组的键
+    if (command.isKeyspaceScan()) {
+        wait_previous();  // 读需要看到同一连接之前写入的结果
+        return makeReadyResponse(scanKeyspace(command));
+    }
+
+    // 找到键所属的Raft组，一条命令的所有键必须属于同一个组
+    int group_id = groupOf(command.args[0]);
+    for (size_t i = command.keyStride(); i < command.keyEnd(); i += command.keyStride()) {
+        if (groupOf(command.args[i]) != group_id) {
+            return makeReadyResponse(RedisProtocol::encodeError("CROSSSLOT Keys in request don't hash to the same raft group"));
+        }
+    }
+    RaftGroup& group = *groups_[group_id];
+
+    // 检查本节点在该组中的状态
+    NodeState state = group.getState();
+    int leader_id = group.getLeaderId();
     
     if (state == NodeState::CANDIDATE) {
         // 候选者状态，拒绝客户端请求
-        return "+TRYAGAIN\r\n";
+        return makeReadyResponse("+TRYAGAIN\r\n");
     } else if (state == NodeState::FOLLOWER) {
-        // 跟随者状态，重定向到Leader
+        // 跟随者状态：只读命令向leader确认读索引后在本地读取，其余命令重定向到Leader
         if (leader_id != 0) {
-            return "+MOVED " + std::to_string(leader_id) + "\r\n";
+            if (command.isReadOnly()) {
+                wait_previous();  // 读需要看到同一连接之前写入的结果
+                return makeReadyResponse(group.read(command));
+            }
+            return makeReadyResponse("+MOVED " + std::to_string(leader_id) + "\r\n");
         } else {
-            return "+TRYAGAIN\r\n";
+            return makeReadyResponse("+TRYAGAIN\r\n");
         }
     } else if (state == NodeState::LEADER) {
-        std::string cmd_type = command[0];
-        std::transform(cmd_type.begin(), cmd_type.end(), cmd_type.begin(), ::toupper);
-
-        // 添加到日志
-        int current_term = raft_core_->getCurrentTerm();
-        int log_index = raft_core_->appendLogEntry(original_request, current_term);
-        //std::cout<<"[RaftNode:] " <<current_term << " "<< log_index << std::endl;
-        
-        int commit_index = raft_core_->getCommitIndex();
-
-        if (cmd_type == "DEL") {
-        //等待log_index-1被提交 
-            while (log_index-1 > commit_index) {
-                //std::cout<<"[RaftNode:] " <<current_term << " "<< commit_index << std::endl;
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                commit_index = raft_core_->getCommitIndex();
-            }
+        // 读请求走ReadIndex，不写日志
+        if (command.isReadOnly()) {
+            wait_previous();  // 读需要看到同一连接之前写入的结果
+            return makeReadyResponse(group.read(command));
         }
 
-        int del_count = 0;//不能等del应用到状态机再在统计，因为del删除完后再去统计，会导致del_count为0
-        if (cmd_type == "DEL") {
-            if (command.size() >= 2) {
-                for (size_t i = 1; i < command.size(); ++i) {
-                    if (!kv_store_->get(command[i]).empty()) {
-                        del_count++;
-                    }
-                }
-            }
-        }
-        // 等待日志被提交
-        while (log_index > commit_index) {
-            //std::cout<<"[RaftNode:] " <<current_term << " "<< commit_index << std::endl;
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            commit_index = raft_core_->getCommitIndex();
-        }
-        
-        
-        // 根据命令类型生成响应
-        if (cmd_type == "GET") {
-            if (command.size() >= 2) {
-                std::string value = kv_store_->get(command[1]);
-                if (value.empty()) {
-                    // 返回nil值
-                    return "*1\r\n$3\r\nnil\r\n";
-                } else {
-                    // 使用专门的GET响应编码方法
-                    //td::cout<<"[RaftNode:] " << value << std::endl;
-                    return RedisProtocol::encodeGetResponse(value);
-                }
-            }
-            return RedisProtocol::encodeError("Wrong number of arguments for GET command");
-        } else if (cmd_type == "SET") {
-            if (command.size() >= 3) {
-                return RedisProtocol::encodeStatus("OK");
-            }
-            return RedisProtocol::encodeError("Wrong number of arguments for SET command");
-        } else if (cmd_type == "DEL") {
-            if(command.size() >= 2){
-                return RedisProtocol::encodeInteger(del_count);
-            }
-            return RedisProtocol::encodeError("Wrong number of arguments for DEL command");
-        } else {
-            return RedisProtocol::encodeError("Unknown command: " + command[0]);
+        // 超过内存上限且不淘汰时，拒绝会增加内存的写入
+        if (command.mayGrowMemory() && group.rejectsWrites()) {
+            return makeReadyResponse(RedisProtocol::encodeError("OOM command not allowed when used memory > 'maxmemory'"));
         }
+
+        // 编码后与同一窗口内的其他命令合并写入日志，不等待应用即返回，流水线中的后续命令可以进入同一条日志
+        std::string encoded;
+        command.encode(encoded);
+        return group.propose(encoded);
     }
     // 处理异常情况
-    return RedisProtocol::encodeError("Internal server error");
+    return makeReadyResponse(RedisProtocol::encodeError("Internal server error"));
 }
 
-// 处理命令应用到状态机
-std::string RaftNode::applyCommand(const std::string& command) {
-    // 解析命令
-    std::vector<std::string> parsed = RedisProtocol::parseCommand(command);
-    if (parsed.empty()) {
-        return RedisProtocol::encodeError("Protocol error");
-    }
-    
-    // 标准化命令
-    std::string cmd_type = parsed[0];
-    std::transform(cmd_type.begin(), cmd_type.end(), cmd_type.begin(), ::toupper);
-    
-    // 根据命令类型执行操作
-    if (cmd_type == "GET") {
-        // GET命令不会改变状态，仅查询
-        return "";
-    } else if (cmd_type == "SET" && parsed.size() >= 3) {
-        // 设置键值
-        std::string key = parsed[1];
-        std::string value = parsed[2];
-        // 如果有多个参数，合并为一个值
-        for (size_t i = 3; i < parsed.size(); ++i) {
-            value += " " + parsed[i];
+// 按字典序分页遍历所有组的键
+bool RaftNode::scanGroups(const std::string& after, const std::string& prefix, size_t count, std::vector<std::string>& keys) {
+    keys.clear();
+    std::vector<std::string> group_keys;
+    for (auto& group : groups_) {
+        // 每个组都需要能确认读索引：本节点是leader，或是知道leader的follower
+        if (group->getState() == NodeState::CANDIDATE || group->getLeaderId() == 0 ||
+            !group->scanKeys(after, prefix, count, group_keys)) {
+            return false;
         }
-        kv_store_->set(key, value);
-        return RedisProtocol::encodeStatus("OK");
-    } else if (cmd_type == "DEL" && parsed.size() >= 2) {
-        // 删除键
-        int count = 0;
-        for (size_t i = 1; i < parsed.size(); ++i) {
-            if (!kv_store_->get(parsed[i]).empty()) {
-                count++;
-                kv_store_->del(parsed[i]);
-            }
-        }
-        return RedisProtocol::encodeInteger(count);
+        keys.insert(keys.end(), group_keys.begin(), group_keys.end());
     }
-    
-    return RedisProtocol::encodeError("unknown command");
+    // 合并各组的结果，保留最小的count个
+    std::sort(keys.begin(), keys.end());
+    if (keys.size() > count) {
+        keys.resize(count);
+    }
+    return true;
 }
 
-// 日志应用线程主循环
-void RaftNode::logApplierLoop() {
-    std::cout << "LogApplier thread started" << std::endl;
-    while (running_) {
-        // 获取当前已提交但未应用的日志
-        int last_applied = raft_core_->getLastApplied();
-        int commit_index = raft_core_->getCommitIndex();
-        
-        if (last_applied < commit_index) {
-            std::lock_guard<std::mutex> lock(apply_mutex_);
-            // 逐条应用日志,当last_applied小于commit_index时，应用日志
-            for (int i = last_applied + 1; i <= commit_index; ++i) {
-                try {
-                    std::string entry_data = log_store_->entry_at(i);
-                    std::cout << "[RaftNode:] " << "Node(" << node_id_ << ")开始应用log(" << i << "): " << entry_data << std::endl;
-                    
-                    // 应用命令到状态机
-                    applyCommand(entry_data);
-                    
-                    // 更新已应用索引
-                    raft_core_->setLastApplied(i);
-                    
-                    std::cout << "[RaftNode:] " << "Node(" << node_id_ << ")完成应用log(" << i << ")" << std::endl;
-                } catch (const std::exception& e) {
-                    std::cerr << "[RaftNode:] " << "Node(" << node_id_ << ")应用日志失败: " << e.what() << std::endl;
-                    break;
-                }
-            }
+// 处理SCAN/KEYS
+std::string RaftNode::scanKeyspace(const Command& command) {
+    std::vector<std::string> keys;
+    if (command.type == CommandType::SCAN) {
+        // 返回一页键和下一页的游标，不足一页时游标为0表示遍历结束
+        size_t count = std::stoull(command.args[2]);
+        if (!scanGroups(command.args[0], command.args[1], count, keys)) {
+            return "+TRYAGAIN\r\n";
         }
-        
-        // 短暂休眠，避免CPU占用过高
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::string cursor = keys.size() < count ? "0" : Command::encodeCursor(keys.back());
+        return "*2\r\n" + RedisProtocol::encode(cursor) + RedisProtocol::encodeArray(keys);
+    }
+
+    // KEYS：逐页读取全部匹配的键，页与页之间不持有存储的锁
+    std::vector<std::string> all_keys;
+    std::string after;
+    while (true) {
+        if (!scanGroups(after, command.args[0], KEYS_PAGE_SIZE, keys)) {
+            return "+TRYAGAIN\r\n";
+        }
+        all_keys.insert(all_keys.end(), keys.begin(), keys.end());
+        if (keys.size() < KEYS_PAGE_SIZE) {
+            break;
+        }
+        after = keys.back();
     }
-    std::cout << "LogApplier thread stopped" << std::endl;
+    return RedisProtocol::encodeArray(all_keys);
 }
 
-} // namespace raft 
\ No newline at end of file
+} // namespace raft
@@ -1,23 +1,20 @@
 #ifndef RAFT_NODE_H
 #define RAFT_NODE_H
 
-#include "../core/raft_core.h"
+#include "../core/raft_group.h"
 #include "../network/network_manager.h"
-#include "../storage/kv_store.h"
-#include "../storage/log_store.h"
 #include "../utils/redis_protocol.h"
+#include "../utils/command.h"
 #include <string>
 #include <vector>
 #include <memory>
-#include <thread>
 #include <atomic>
-#include <mutex>
 
 namespace raft {
 
 /**
  * RaftNode类 - 顶层节点类，整合各个重构后的组件
- * 包括RaftCore、NetworkManager、KVStore等
+ * 包括多个RaftGroup和它们共享的NetworkManager，客户端请求按键路由到对应的组
  */
 class RaftNode {
 public:
@@ -49,6 +46,12 @@ private:
      */
     bool initComponents();
     
+    /**
+     * 解析配置文件中的内存上限（maxmemory <字节数>[kb|mb|gb]）和淘汰策略
+     * （maxmemory-policy noeviction|allkeys-lru|allkeys-lfu），未配置时不限制内存
+     */
+    void parseMemoryConfig();
+    
     /**
      * 处理网络收到的消息回调
      */
@@ -57,48 +60,53 @@ private:
     /**
      * 处理客户端请求回调
      */
-    std::string handleClientRequest(int client_fd, const std::string& request);
+    std::future<std::string> handleClientRequest(int client_fd, const std::string& request,
+                                                 const std::function<void()>& wait_previous);
     
     /**
-     * 处理RESP格式的客户端请求
+     * 处理解析后的客户端命令
      * @param client_fd 客户端连接fd
-     * @param command 解析后的命令
-     * @param original_request 原始请求内容
-     * @return 处理结果
+     * @param command 解析并检查过参数的命令
+     * @param wait_previous 等待同一连接之前的请求完成
+     * @return 处理结果，写命令在排队写入日志后即返回，应用后就绪
+     */
+    std::future<std::string> handleCommand(int client_fd, const Command& command,
+                                           const std::function<void()>& wait_previous);
+    
+    /**
+     * 处理SCAN/KEYS：通过ReadIndex分页遍历所有组的键
+     * @param command SCAN或KEYS命令
+     * @return 返回给客户端的响应
      */
-    std::string handleRespCommand(int client_fd, const std::vector<std::string>& command, const std::string& original_request);
+    std::string scanKeyspace(const Command& command);
     
     /**
-     * 处理命令应用到状态机
+     * 按字典序读取所有组中大于after且以prefix开头的至多count个键
+     * @return 是否读取成功（有组无法确认读索引时返回false）
      */
-    std::string applyCommand(const std::string& command);
+    bool scanGroups(const std::string& after, const std::string& prefix, size_t count, std::vector<std::string>& keys);
     
     /**
-     * 日志应用线程主循环
-     * 负责将已提交的日志应用到状态机
+     * 计算键所属的Raft组
+     * @param key 键
+     * @return 组ID
      */
-    void logApplierLoop();
+    int groupOf(const std::string& key) const;
     
 private:
     // 基本信息
     int node_id_;                                    // 节点ID（从配置文件解析）
     std::string config_path_;                        // 配置文件路径
     std::string log_dir_;                            // 日志目录
+    size_t max_memory_ = 0;                          // 内存上限（字节），0表示不限制，由各组平分
+    EvictionPolicy eviction_policy_ = EvictionPolicy::NOEVICTION; // 淘汰策略
     
     // 核心组件
-    std::unique_ptr<LogStore> log_store_;            // 日志存储
-    std::unique_ptr<KVStore> kv_store_;              // KV存储
-    std::unique_ptr<RaftCore> raft_core_;            // Raft核心
-    std::unique_ptr<NetworkManager> network_manager_; // 网络管理器
+    std::vector<std::unique_ptr<RaftGroup>> groups_; // Raft组，按键的哈希划分键空间
+    std::unique_ptr<NetworkManager> network_manager_; // 网络管理器（各组共享）
     
     // 状态标记
     std::atomic<bool> running_;                      // 运行标志
-    
-    // 线程
-    std::thread log_apply_thread_;                   // 日志应用线程
-    
-    // 互斥锁
-    std::mutex apply_mutex_;                         // 应用互斥锁
 };
 
 } // namespace raft
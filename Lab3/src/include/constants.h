@@ -1,16 +1,25 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstddef>
+
 namespace raft {
 
 // 网络相关常量
-constexpr int MAX_BUFFER_SIZE = 4096;        // 最大缓冲区大小
+constexpr int MAX_BUFFER_SIZE = 64 * 1024;   // 接收缓冲区的初始大小(字节)
+constexpr size_t RECV_MIN_FREE_SPACE = 4096; // 接收缓冲区剩余空间少于该值时先整理或扩容再recv(字节)
+constexpr size_t MAX_POOLED_BUFFER_SIZE = 4 * 1024 * 1024; // 复用的发送编码缓冲区保留的最大容量(字节)
+constexpr size_t OUTBOUND_CHUNK_SIZE = 64 * 1024;  // 发送队列中合并小消息的块大小(字节)
+constexpr int OUTBOUND_IOV_COUNT = 64;             // 一次writev最多写出的块数
+constexpr size_t MAX_OUTBOUND_QUEUE_SIZE = 64 * 1024 * 1024; // 单个连接未发送数据的上限(字节)，超过时Raft消息被丢弃、客户端连接被关闭
 constexpr int MAX_CONNECTION_QUEUE = 10;     // 最大连接队列长度
-constexpr int MAX_EVENT = 20;                // epoll一次处理的最大事件数
+constexpr int MAX_EVENT = 32;                // epoll一次处理的最大事件数
+constexpr int CLIENT_REACTOR_COUNT = 2;      // 处理客户端连接的事件循环数，各自通过SO_REUSEPORT监听客户端端口
+constexpr bool RAFT_DEDICATED_REACTOR = true; // Raft连接是否使用单独的事件循环（否则由最后一个客户端事件循环兼顾）
 constexpr int EPOLL_TIMEOUT_MS = 100;        // epoll等待超时时间(ms)
 
 // 线程池相关常量
-constexpr int THREAD_POOL_SIZE = 4;          // 线程池大小
+constexpr int THREAD_POOL_SIZE = 34;         // 线程池大小（客户端线程会阻塞等待提交，需多于并发连接数才能合并写入）
 constexpr int RAFT_MESSAGE_THREADS = 2;      // 保留给Raft消息处理的线程数
 constexpr int TASK_QUEUE_MAX_SIZE = 1000;    // 任务队列最大大小
 
@@ -19,16 +28,42 @@ constexpr int PORT_TYPE_CLIENT = 1;          // 客户端端口类型
 constexpr int PORT_TYPE_RAFT = 2;            // Raft内部通信端口类型
 
 // Raft算法相关常量
-constexpr int FOLLOWER_TIMEOUT_MS = 3000;  // 选举超时最小值(ms)
-constexpr int ELECTION_TIMEOUT_MIN_MS = 1000;  // 选举超时最小值(ms)
-constexpr int ELECTION_TIMEOUT_MAX_MS = 3000;  // 选举超时最大值(ms)
-constexpr int HEARTBEAT_INTERVAL_MS = 500;        // 心跳间隔(ms)
-constexpr int LEADER_RESILIENCE_COUNT = 1;    // Leader弹性计数
-constexpr int BATCH_SIZE = 10;                // 日志批处理大小
+constexpr int ELECTION_TIMEOUT_MIN_MS = 300;  // 选举超时最小值(ms)，每次重置时在[MIN, MAX]内随机
+constexpr int ELECTION_TIMEOUT_MAX_MS = 600;  // 选举超时最大值(ms)；leader在这段时间内联系不上多数派时退位
+constexpr int HEARTBEAT_INTERVAL_MS = 100;        // 心跳间隔(ms)
+constexpr int RAFT_GROUP_COUNT = 1;           // 每个进程运行的Raft组数，键按哈希分到各组；跨组的多键命令会被拒绝
+constexpr int GROUP_LEADER_PREFERENCE_MS = 200; // 多组时非首选节点额外等待的选举超时(ms)，使各组leader分散到不同节点
+constexpr int BATCH_SIZE = 128;               // 一次AppendEntries最多携带的日志条数
+constexpr int MAX_INFLIGHT_APPEND = 4;        // 每个follower同时在途的AppendEntries上限
+constexpr int CLIENT_BATCH_MAX_DELAY_US = 100; // leader合并客户端命令的等待窗口(us)
+constexpr size_t CLIENT_BATCH_MAX_BYTES = 64 * 1024; // 合并后单条日志的字节上限
+constexpr int REPLICATION_TIMEOUT_MS = 1000;  // 在途请求超过该时间无响应时从matchIndex重发(ms)
+
+// 日志存储相关常量
+constexpr size_t LOG_SEGMENT_SIZE = 64 * 1024 * 1024; // 单个日志段文件大小上限(字节)
+constexpr int GROUP_COMMIT_MAX_BATCH = 256;   // 组提交: 积累到该条数立即刷盘
+constexpr int GROUP_COMMIT_MAX_DELAY_US = 200; // 组提交: 未满一批时最多等待的时间(us)
+constexpr int GROUP_COMMIT_RETRY_MS = 100;    // 组提交: 写盘或同步失败后重试的间隔(ms)
+constexpr int SNAPSHOT_LOG_THRESHOLD = 10000;  // 距上次快照应用超过该条数时生成新快照
+constexpr size_t KV_SHARD_COUNT = 16;          // KV存储分片数，每个分片独立加锁
+constexpr size_t SCAN_DEFAULT_COUNT = 10;      // SCAN未指定COUNT时每页返回的键数
+constexpr size_t KEYS_PAGE_SIZE = 1024;        // KEYS分页遍历时每页的键数，页与页之间不持有分片锁
 
 // 日志应用相关常量
 constexpr int LOG_APPLY_INTERVAL_MS = 100;     // 日志应用检查间隔(ms)
-//constexpr int MAX_APPLY_BATCH = 100;          // 一次最多应用的日志条数
+constexpr int MAX_APPLY_BATCH = 1024;         // 一次加锁最多应用的日志条数
+
+// 键过期相关常量
+constexpr int EXPIRY_TICK_MS = 10;            // 过期时间轮每格的时间跨度，也是过期线程的检查间隔(ms)
+constexpr int EXPIRY_RETRY_MS = 1000;         // 到期键的删除尚未应用时，隔该时间再次检查(ms)
+
+// 内存淘汰相关常量
+constexpr int EVICTION_SAMPLES = 5;           // 每淘汰一个键采样的键数
+constexpr size_t EVICTION_MAX_KEYS = 1024;    // 一条淘汰日志最多包含的键数
+constexpr int LRU_CLOCK_RESOLUTION_MS = 10;   // LRU访问时钟的精度(ms)
+constexpr int LFU_INIT_COUNTER = 5;           // 新键的LFU计数，避免刚写入的键立刻被淘汰
+constexpr int LFU_LOG_FACTOR = 10;            // LFU计数按对数增长的因子，越大增长越慢
+constexpr int LFU_DECAY_MINUTES = 1;          // LFU计数每隔该时间未访问减1(分钟)
 
 // 超时与重试相关常量
 constexpr int COMMAND_WAIT_TIMEOUT_MS = 5000; // 命令等待超时时间(ms)
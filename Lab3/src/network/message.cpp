@@ -4,303 +4,170 @@
 
 namespace raft {
 
-// ---------- LogEntry 实现 ----------
-std::string LogEntry::serialize() const {
-    // 格式: [term(4字节)][数据长度(4字节)][数据内容]
-    size_t total_size = sizeof(int) + sizeof(uint32_t) + data.size();
-    std::string result;
-    result.resize(total_size);
-    
-    char* ptr = &result[0];
-    
-    // 写入term
-    std::memcpy(ptr, &term, sizeof(int));
-    ptr += sizeof(int);
-    
-    // 写入数据长度
-    uint32_t data_size = static_cast<uint32_t>(data.size());
-    std::memcpy(ptr, &data_size, sizeof(uint32_t));
-    ptr += sizeof(uint32_t);
-    
-    // 写入数据内容
-    std::memcpy(ptr, data.c_str(), data.size());
-    
-    return result;
-}
-
-LogEntry LogEntry::deserialize(const char* data, size_t size) {
-    if (size < sizeof(int) + sizeof(uint32_t)) {
-        throw std::runtime_error("LogEntry反序列化错误: 数据太短");
-    }
-    
-    LogEntry entry;
-    const char* ptr = data;
-    
-    // 读取term
-    std::memcpy(&entry.term, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    // 读取数据长度
-    uint32_t data_size;
-    std::memcpy(&data_size, ptr, sizeof(uint32_t));
-    ptr += sizeof(uint32_t);
-    
-    // 验证数据长度
-    if (size < sizeof(int) + sizeof(uint32_t) + data_size) {
-        throw std::runtime_error("LogEntry反序列化错误: 数据不完整");
-    }
-    
-    // 读取数据内容
-    entry.data.assign(ptr, data_size);
-    
-    return entry;
-}
-
-LogEntry LogEntry::deserialize(const std::string& data) {
-    return deserialize(data.c_str(), data.size());
-}
-
-size_t LogEntry::getSerializedSize() const {
-    return sizeof(int) + sizeof(uint32_t) + data.size();
-}
-
 // ---------- RequestVoteRequest 实现 ----------
-std::string RequestVoteRequest::serialize() const {
-    // 格式: [term(4字节)][candidate_id(4字节)][last_log_index(4字节)][last_log_term(4字节)]
-    std::string result;
-    result.resize(4 * sizeof(int));
-    
-    char* ptr = &result[0];
-    
-    std::memcpy(ptr, &term, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &candidate_id, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &last_log_index, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &last_log_term, sizeof(int));
-    
-    return result;
+void RequestVoteRequest::encode(BufferWriter& out) const {
+    // 格式: [term(4字节)][candidate_id(4字节)][last_log_index(4字节)][last_log_term(4字节)][pre_vote(1字节)]
+    out.writeI32(term);
+    out.writeI32(candidate_id);
+    out.writeI32(last_log_index);
+    out.writeI32(last_log_term);
+    out.writeBool(pre_vote);
 }
 
-bool RequestVoteRequest::deserialize(const char* data, size_t size) {
-    if (size < 4 * sizeof(int)) {
-        return false;
-    }
-    
-    const char* ptr = data;
-    
-    std::memcpy(&term, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&candidate_id, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&last_log_index, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&last_log_term, ptr, sizeof(int));
-    
-    return true;
+bool RequestVoteRequest::decode(BufferReader& in) {
+    return in.readI32(term) && in.readI32(candidate_id) && in.readI32(last_log_index) &&
+           in.readI32(last_log_term) && in.readBool(pre_vote);
 }
 
 // ---------- RequestVoteResponse 实现 ----------
-std::string RequestVoteResponse::serialize() const {
-    // 格式: [term(4字节)][vote_granted(1字节)]
-    std::string result;
-    result.resize(sizeof(int) + sizeof(bool));
-    
-    char* ptr = &result[0];
-    
-    std::memcpy(ptr, &term, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &vote_granted, sizeof(bool));
-    
-    return result;
+void RequestVoteResponse::encode(BufferWriter& out) const {
+    // 格式: [term(4字节)][vote_granted(1字节)][pre_vote(1字节)]
+    out.writeI32(term);
+    out.writeBool(vote_granted);
+    out.writeBool(pre_vote);
 }
 
-bool RequestVoteResponse::deserialize(const char* data, size_t size) {
-    if (size < sizeof(int) + sizeof(bool)) {
-        return false;
-    }
-    
-    const char* ptr = data;
-    
-    std::memcpy(&term, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&vote_granted, ptr, sizeof(bool));
-    
-    return true;
+bool RequestVoteResponse::decode(BufferReader& in) {
+    return in.readI32(term) && in.readBool(vote_granted) && in.readBool(pre_vote);
 }
 
 // ---------- AppendEntriesRequest 实现 ----------
-std::string AppendEntriesRequest::serialize() const {
-    // 计算总大小: 基本字段 + 条目计数 + 所有条目的序列化大小
+void AppendEntriesRequest::addEntry(int term, std::string data) {
+    entry_storage_.push_back(std::move(data));
+    entries.push_back(LogEntry{term, entry_storage_.back()});
+}
+
+void AppendEntriesRequest::encode(BufferWriter& out) const {
+    // 格式: [term(4)][leader_id(4)][prev_log_index(4)][prev_log_term(4)][leader_commit(4)][seq(4)][条目数(4)]
+    //       {[条目任期(4)][数据长度(4)][数据]}...
     size_t entries_size = 0;
     for (const auto& entry : entries) {
-        entries_size += entry.getSerializedSize();
+        entries_size += 2 * sizeof(uint32_t) + entry.data.size();
     }
-    
-    // 格式: [term(4)][leader_id(4)][prev_log_index(4)][prev_log_term(4)][leader_commit(4)][seq(4)][条目数(4)][条目...]
-    size_t total_size = 6 * sizeof(int) + sizeof(uint32_t) + entries_size;
-    std::string result;
-    result.resize(total_size);
-    
-    char* ptr = &result[0];
-    
-    std::memcpy(ptr, &term, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &leader_id, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &prev_log_index, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &prev_log_term, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &leader_commit, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &seq, sizeof(int));
-    ptr += sizeof(int);
-    
-    // 写入条目数
-    uint32_t entry_count = static_cast<uint32_t>(entries.size());
-    std::memcpy(ptr, &entry_count, sizeof(uint32_t));
-    ptr += sizeof(uint32_t);
-    
-    // 写入每个条目
+    out.reserve(out.size() + 7 * sizeof(uint32_t) + entries_size);
+
+    out.writeI32(term);
+    out.writeI32(leader_id);
+    out.writeI32(prev_log_index);
+    out.writeI32(prev_log_term);
+    out.writeI32(leader_commit);
+    out.writeI32(seq);
+    out.writeU32(static_cast<uint32_t>(entries.size()));
     for (const auto& entry : entries) {
-        std::string entry_data = entry.serialize();
-        std::memcpy(ptr, entry_data.c_str(), entry_data.size());
-        ptr += entry_data.size();
+        out.writeI32(entry.term);
+        out.writeString(entry.data);
     }
-    
-    return result;
 }
 
-bool AppendEntriesRequest::deserialize(const char* data, size_t size) {
-    if (size < 6 * sizeof(int) + sizeof(uint32_t)) {
+bool AppendEntriesRequest::decode(BufferReader& in) {
+    uint32_t entry_count = 0;
+    if (!in.readI32(term) || !in.readI32(leader_id) || !in.readI32(prev_log_index) ||
+        !in.readI32(prev_log_term) || !in.readI32(leader_commit) || !in.readI32(seq) ||
+        !in.readU32(entry_count)) {
         return false;
     }
-    
-    const char* ptr = data;
-    
-    std::memcpy(&term, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&leader_id, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&prev_log_index, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&prev_log_term, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&leader_commit, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&seq, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    // 读取条目数
-    uint32_t entry_count;
-    std::memcpy(&entry_count, ptr, sizeof(uint32_t));
-    ptr += sizeof(uint32_t);
-    
-    // 清空原有条目
+    // 每个条目至少有任期和长度两个字段，条目数不可能超过剩余字节数的1/8
+    if (entry_count > in.remaining() / (2 * sizeof(uint32_t))) {
+        return false;
+    }
+
     entries.clear();
-    
-    // 读取每个条目
-    try {
-        size_t remaining_size = size - (ptr - data);
-        for (uint32_t i = 0; i < entry_count && remaining_size > 0; ++i) {
-            // 尝试反序列化一个条目
-            LogEntry entry = LogEntry::deserialize(ptr, remaining_size);
-            
-            // 添加到条目列表
-            entries.push_back(entry);
-            
-            // 移动指针
-            size_t entry_size = entry.getSerializedSize();
-            ptr += entry_size;
-            remaining_size -= entry_size;
-        }
-        
-        // 检查是否所有条目都成功反序列化
-        if (entries.size() != entry_count) {
+    entry_storage_.clear();
+    frame_ = in.owner();
+    entries.reserve(entry_count);
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        int entry_term = 0;
+        std::string_view data;
+        if (!in.readI32(entry_term) || !in.readStringView(data)) {
             return false;
         }
-    } catch (const std::exception&) {
-        return false;
+        if (frame_) {
+            // 输入是共享的接收缓冲区：条目直接引用，不拷贝
+            entries.push_back(LogEntry{entry_term, data});
+        } else {
+            // 输入由调用者临时持有：拷贝一份保存在消息里
+            addEntry(entry_term, std::string(data));
+        }
     }
-    
     return true;
 }
 
 // ---------- AppendEntriesResponse 实现 ----------
-std::string AppendEntriesResponse::serialize() const {
+void AppendEntriesResponse::encode(BufferWriter& out) const {
     // 格式: [term(4)][follower_id(4)][log_index(4)][success(1)][follower_commit(4)][ack(4)]
-    std::string result;
-    result.resize(5 * sizeof(int) + sizeof(bool));
-    
-    char* ptr = &result[0];
-    
-    std::memcpy(ptr, &term, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &follower_id, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &log_index, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &success, sizeof(bool));
-    ptr += sizeof(bool);
-    
-    std::memcpy(ptr, &follower_commit, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(ptr, &ack, sizeof(int));
-    
-    return result;
+    //       [conflict_term(4)][conflict_index(4)]
+    out.writeI32(term);
+    out.writeI32(follower_id);
+    out.writeI32(log_index);
+    out.writeBool(success);
+    out.writeI32(follower_commit);
+    out.writeI32(ack);
+    out.writeI32(conflict_term);
+    out.writeI32(conflict_index);
 }
 
-bool AppendEntriesResponse::deserialize(const char* data, size_t size) {
-    if (size < 5 * sizeof(int) + sizeof(bool)) {
-        return false;
-    }
-    
-    const char* ptr = data;
-    
-    std::memcpy(&term, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&follower_id, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&log_index, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&success, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-    
-    std::memcpy(&follower_commit, ptr, sizeof(int));
-    ptr += sizeof(int);
-    
-    std::memcpy(&ack, ptr, sizeof(int));
-    
-    return true;
+bool AppendEntriesResponse::decode(BufferReader& in) {
+    return in.readI32(term) && in.readI32(follower_id) && in.readI32(log_index) &&
+           in.readBool(success) && in.readI32(follower_commit) && in.readI32(ack) &&
+           in.readI32(conflict_term) && in.readI32(conflict_index);
 }
 
+// ---------- InstallSnapshotRequest 实现 ----------
+void InstallSnapshotRequest::encode(BufferWriter& out) const {
+    // 格式: [term(4)][leader_id(4)][last_included_index(4)][last_included_term(4)][数据长度(4)][数据]
+    out.reserve(out.size() + 5 * sizeof(uint32_t) + data.size());
+    out.writeI32(term);
+    out.writeI32(leader_id);
+    out.writeI32(last_included_index);
+    out.writeI32(last_included_term);
+    out.writeString(data);
+}
+
+bool InstallSnapshotRequest::decode(BufferReader& in) {
+    // 快照数据要交给状态机恢复并写入快照文件，直接拷贝出来
+    return in.readI32(term) && in.readI32(leader_id) && in.readI32(last_included_index) &&
+           in.readI32(last_included_term) && in.readString(data);
+}
+
+// ---------- InstallSnapshotResponse 实现 ----------
+void InstallSnapshotResponse::encode(BufferWriter& out) const {
+    // 格式: [term(4)][follower_id(4)][last_included_index(4)][success(1)]
+    out.writeI32(term);
+    out.writeI32(follower_id);
+    out.writeI32(last_included_index);
+    out.writeBool(success);
+}
+
+bool InstallSnapshotResponse::decode(BufferReader& in) {
+    return in.readI32(term) && in.readI32(follower_id) && in.readI32(last_included_index) &&
+           in.readBool(success);
+}
+
+// ---------- ReadIndexRequest 实现 ----------
+void ReadIndexRequest::encode(BufferWriter& out) const {
+    // 格式: [term(4)][follower_id(4)][request_id(8)]
+    out.writeI32(term);
+    out.writeI32(follower_id);
+    out.writeU64(request_id);
+}
+
+bool ReadIndexRequest::decode(BufferReader& in) {
+    return in.readI32(term) && in.readI32(follower_id) && in.readU64(request_id);
+}
+
+// ---------- ReadIndexResponse 实现 ----------
+void ReadIndexResponse::encode(BufferWriter& out) const {
+    // 格式: [term(4)][leader_id(4)][request_id(8)][read_index(4)]
+    out.writeI32(term);
+    out.writeI32(leader_id);
+    out.writeU64(request_id);
+    out.writeI32(read_index);
+}
+
+bool ReadIndexResponse::decode(BufferReader& in) {
+    return in.readI32(term) && in.readI32(leader_id) && in.readU64(request_id) &&
+           in.readI32(read_index);
+}
 
 // ---------- 工厂方法实现 ----------
 std::unique_ptr<Message> createMessage(MessageType type) {
@@ -313,30 +180,53 @@ std::unique_ptr<Message> createMessage(MessageType type) {
             return std::make_unique<AppendEntriesRequest>();
         case MessageType::APPENDENTRIES_RESPONSE:
             return std::make_unique<AppendEntriesResponse>();
+        case MessageType::INSTALLSNAPSHOT_REQUEST:
+            return std::make_unique<InstallSnapshotRequest>();
+        case MessageType::INSTALLSNAPSHOT_RESPONSE:
+            return std::make_unique<InstallSnapshotResponse>();
+        case MessageType::READINDEX_REQUEST:
+            return std::make_unique<ReadIndexRequest>();
+        case MessageType::READINDEX_RESPONSE:
+            return std::make_unique<ReadIndexResponse>();
         default:
             throw std::runtime_error("未知的消息类型");
     }
 }
 
-std::unique_ptr<Message> parseMessage(const char* data, size_t size) {
-    try {
-        // 替换结构化绑定语法
-        std::pair<MessageType, std::string> extractResult = Message::extractPayload(data, size);
-        MessageType type = extractResult.first;
-        std::string payload = extractResult.second;
-        
-        auto message = createMessage(type);
-        if (!message->deserialize(payload)) {
-            throw std::runtime_error("消息反序列化失败");
-        }
-        return message;
-    } catch (const std::exception& e) {
-        throw std::runtime_error(std::string("消息解析失败: ") + e.what());
+namespace {
+
+// 解析[data, data+size)处的网络消息，owner非空时日志条目直接引用owner
+std::unique_ptr<Message> parseFrame(const char* data, size_t size,
+                                    std::shared_ptr<const std::string> owner) {
+    MessageHeader header;
+    if (!Message::decodeHeader(data, size, header)) {
+        throw std::runtime_error("消息解析失败: 消息太短，无法提取头");
+    }
+    if (size - MESSAGE_HEADER_SIZE < header.payload_size) {
+        throw std::runtime_error("消息解析失败: 消息不完整");
+    }
+
+    auto message = createMessage(header.type);
+    BufferReader reader(data + MESSAGE_HEADER_SIZE, header.payload_size, std::move(owner));
+    if (!message->decode(reader)) {
+        throw std::runtime_error("消息解析失败: 消息反序列化失败");
     }
+    message->group_id = static_cast<int>(header.group_id);
+    return message;
+}
+
+} // namespace
+
+std::unique_ptr<Message> parseMessage(const char* data, size_t size) {
+    return parseFrame(data, size, nullptr);
 }
 
 std::unique_ptr<Message> parseMessage(const std::string& data) {
     return parseMessage(data.c_str(), data.size());
 }
 
-} // namespace raft 
\ No newline at end of file
+std::unique_ptr<Message> parseMessage(const std::shared_ptr<const std::string>& buffer, size_t offset, size_t size) {
+    return parseFrame(buffer->data() + offset, size, buffer);
+}
+
+} // namespace raft
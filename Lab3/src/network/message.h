@@ -2,12 +2,15 @@
 #define MESSAGE_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
 #include <cstdint>
 #include <cstring>
 #include <memory>
 #include <stdexcept>
 #include "../include/constants.h"
+#include "../utils/codec.h"
 
 namespace raft {
 
@@ -16,70 +19,88 @@ enum class MessageType : uint32_t {
     REQUESTVOTE_REQUEST = 1,
     REQUESTVOTE_RESPONSE = 2,
     APPENDENTRIES_REQUEST = 3,
-    APPENDENTRIES_RESPONSE = 4
+    APPENDENTRIES_RESPONSE = 4,
+    INSTALLSNAPSHOT_REQUEST = 5,
+    INSTALLSNAPSHOT_RESPONSE = 6,
+    READINDEX_REQUEST = 7,
+    READINDEX_RESPONSE = 8
 };
 
 // 日志条目结构
+// data是视图：发送方指向消息自己保存的条目副本，接收方直接指向接收到的消息帧，不再拷贝
 struct LogEntry {
     int term;                // 条目的任期
-    std::string data;        // 条目的数据
-    
-    // 序列化方法
-    std::string serialize() const;
-    static LogEntry deserialize(const char* data, size_t size);
-    static LogEntry deserialize(const std::string& data);
-    size_t getSerializedSize() const;
+    std::string_view data;   // 条目的数据
 };
 
-// 消息头结构
+// 消息头结构，线上格式为三个小端uint32
 struct MessageHeader {
     MessageType type;         // 消息类型
     uint32_t payload_size;    // 负载大小（不包括消息头）
+    uint32_t group_id;        // 消息所属的Raft组
 };
+constexpr size_t MESSAGE_HEADER_SIZE = 3 * sizeof(uint32_t);
 
 // 基础消息接口
 class Message {
 public:
+    int group_id = 0;         // 消息所属的Raft组，随消息头传输
+
     virtual ~Message() {}
     
+    // 把负载编码到输出缓冲区末尾
+    virtual void encode(BufferWriter& out) const = 0;
+    
+    // 从输入中解码负载
+    virtual bool decode(BufferReader& in) = 0;
+    
+    // 获取消息类型
+    virtual MessageType getType() const = 0;
+    
     // 序列化为字符串
-    virtual std::string serialize() const = 0;
+    std::string serialize() const {
+        std::string result;
+        BufferWriter writer(result);
+        encode(writer);
+        return result;
+    }
     
     // 反序列化
-    virtual bool deserialize(const char* data, size_t size) = 0;
-    virtual bool deserialize(const std::string& data) {
+    bool deserialize(const char* data, size_t size) {
+        BufferReader reader(data, size);
+        return decode(reader);
+    }
+    bool deserialize(const std::string& data) {
         return deserialize(data.c_str(), data.size());
     }
     
-    // 获取消息类型
-    virtual MessageType getType() const = 0;
+    // 把完整的网络消息（消息头和负载）追加到out末尾，out可以是复用的缓冲区
+    void encodeNetworkMessage(std::string& out) const {
+        BufferWriter writer(out);
+        size_t start = writer.size();
+        writer.writeU32(static_cast<uint32_t>(getType()));
+        writer.writeU32(0);  // 负载大小，编码完负载后回填
+        writer.writeU32(static_cast<uint32_t>(group_id));
+        encode(writer);
+        writer.patchU32(start + sizeof(uint32_t), static_cast<uint32_t>(writer.size() - start - MESSAGE_HEADER_SIZE));
+    }
     
     // 创建完整的网络消息（包括头和序列化后的负载）
     std::string createNetworkMessage() const {
-        std::string payload = serialize();
-        MessageHeader header{getType(), static_cast<uint32_t>(payload.size())};
-        
         std::string result;
-        result.resize(sizeof(MessageHeader) + payload.size());
-        std::memcpy(&result[0], &header, sizeof(MessageHeader));
-        std::memcpy(&result[sizeof(MessageHeader)], payload.c_str(), payload.size());
-        
+        encodeNetworkMessage(result);
         return result;
     }
     
-    // 从网络消息中提取消息体
-    static std::pair<MessageType, std::string> extractPayload(const char* data, size_t size) {
-        if (size < sizeof(MessageHeader)) {
-            throw std::runtime_error("消息太短，无法提取头");
-        }
-        
-        const MessageHeader* header = reinterpret_cast<const MessageHeader*>(data);
-        if (size < sizeof(MessageHeader) + header->payload_size) {
-            throw std::runtime_error("消息不完整");
+    // 解析消息头，数据不足一个消息头时返回false
+    static bool decodeHeader(const char* data, size_t size, MessageHeader& header) {
+        BufferReader reader(data, size);
+        uint32_t type = 0;
+        if (!reader.readU32(type) || !reader.readU32(header.payload_size) || !reader.readU32(header.group_id)) {
+            return false;
         }
-        
-        std::string payload(data + sizeof(MessageHeader), header->payload_size);
-        return {header->type, payload};
+        header.type = static_cast<MessageType>(type);
+        return true;
     }
 };
 
@@ -90,13 +111,14 @@ public:
     int candidate_id;       // 候选者ID
     int last_log_index;     // 候选者的最后日志索引
     int last_log_term;      // 候选者最后日志的任期
+    bool pre_vote = false;  // 是否为Pre-Vote：询问能否当选，term为候选者将要使用的任期，不改变接收者状态
     
     MessageType getType() const override {
         return MessageType::REQUESTVOTE_REQUEST;
     }
     
-    std::string serialize() const override;
-    bool deserialize(const char* data, size_t size) override;
+    void encode(BufferWriter& out) const override;
+    bool decode(BufferReader& in) override;
 };
 
 // 投票响应消息
@@ -104,13 +126,14 @@ class RequestVoteResponse : public Message {
 public:
     int term;               // 当前任期号
     bool vote_granted;      // 是否投票给候选者
+    bool pre_vote = false;  // 是否为Pre-Vote的响应；同意时term为请求中的任期
     
     MessageType getType() const override {
         return MessageType::REQUESTVOTE_RESPONSE;
     }
     
-    std::string serialize() const override;
-    bool deserialize(const char* data, size_t size) override;
+    void encode(BufferWriter& out) const override;
+    bool decode(BufferReader& in) override;
 };
 
 // 附加日志请求消息
@@ -124,12 +147,24 @@ public:
     std::vector<LogEntry> entries;      // 要附加的日志条目
     int seq;                            // 序列号，用于标识请求
 
+    AppendEntriesRequest() = default;
+    // 条目是指向本消息所持缓冲区的视图，禁止拷贝
+    AppendEntriesRequest(const AppendEntriesRequest&) = delete;
+    AppendEntriesRequest& operator=(const AppendEntriesRequest&) = delete;
+
+    // 发送方添加一条日志条目，数据移入消息自己保存
+    void addEntry(int term, std::string data);
+
     MessageType getType() const override {
         return MessageType::APPENDENTRIES_REQUEST;
     }
     
-    std::string serialize() const override;
-    bool deserialize(const char* data, size_t size) override;
+    void encode(BufferWriter& out) const override;
+    bool decode(BufferReader& in) override;
+
+private:
+    std::deque<std::string> entry_storage_;      // 发送方的条目数据（deque追加时不移动已有元素）
+    std::shared_ptr<const std::string> frame_;   // 接收方的消息帧，条目视图指向其中
 };
 
 // 附加日志响应消息
@@ -141,15 +176,80 @@ public:
     bool success;           // 是否成功添加日志
     int follower_commit;    // 跟随者的提交索引
     int ack;                // 确认的序列号
+    int conflict_term = 0;  // 失败时：prev_log_index处的冲突任期，0表示跟随者缺少该日志
+    int conflict_index = 0; // 失败时：冲突任期在跟随者日志中的第一条索引（缺少日志时为最新索引+1）
 
     MessageType getType() const override {
         return MessageType::APPENDENTRIES_RESPONSE;
     }
     
-    std::string serialize() const override;
-    bool deserialize(const char* data, size_t size) override;
+    void encode(BufferWriter& out) const override;
+    bool decode(BufferReader& in) override;
 };
 
+// 安装快照请求消息
+class InstallSnapshotRequest : public Message {
+public:
+    int term;                           // 领导者的任期
+    int leader_id;                      // 领导者ID
+    int last_included_index;            // 快照覆盖的最后一条日志索引
+    int last_included_term;             // 该日志的任期
+    std::string data;                   // 快照数据
+
+    MessageType getType() const override {
+        return MessageType::INSTALLSNAPSHOT_REQUEST;
+    }
+
+    void encode(BufferWriter& out) const override;
+    bool decode(BufferReader& in) override;
+};
+
+// 安装快照响应消息
+class InstallSnapshotResponse : public Message {
+public:
+    int term;                           // 当前任期号
+    int follower_id;                    // 跟随者ID
+    int last_included_index;            // 跟随者已安装的快照索引
+    bool success;                       // 是否成功安装
+
+    MessageType getType() const override {
+        return MessageType::INSTALLSNAPSHOT_RESPONSE;
+    }
+
+    void encode(BufferWriter& out) const override;
+    bool decode(BufferReader& in) override;
+};
+
+// ReadIndex请求消息（跟随者向leader查询读索引）
+class ReadIndexRequest : public Message {
+public:
+    int term;                           // 跟随者的当前任期
+    int follower_id;                    // 跟随者ID
+    uint64_t request_id;                // 请求ID，用于匹配响应
+
+    MessageType getType() const override {
+        return MessageType::READINDEX_REQUEST;
+    }
+
+    void encode(BufferWriter& out) const override;
+    bool decode(BufferReader& in) override;
+};
+
+// ReadIndex响应消息
+class ReadIndexResponse : public Message {
+public:
+    int term;                           // leader的当前任期
+    int leader_id;                      // leaderID
+    uint64_t request_id;                // 对应的请求ID
+    int read_index;                     // 读索引，-1表示无法确认
+
+    MessageType getType() const override {
+        return MessageType::READINDEX_RESPONSE;
+    }
+
+    void encode(BufferWriter& out) const override;
+    bool decode(BufferReader& in) override;
+};
 
 // 根据消息类型创建具体消息对象
 std::unique_ptr<Message> createMessage(MessageType type);
@@ -157,6 +257,8 @@ std::unique_ptr<Message> createMessage(MessageType type);
 // 从完整的网络消息中解析出具体的消息对象
 std::unique_ptr<Message> parseMessage(const char* data, size_t size);
 std::unique_ptr<Message> parseMessage(const std::string& data);
+// 解析共享缓冲区中[offset, offset+size)处的网络消息，日志条目直接引用该缓冲区
+std::unique_ptr<Message> parseMessage(const std::shared_ptr<const std::string>& buffer, size_t offset, size_t size);
 
 } // namespace raft
 
@@ -1,28 +1,25 @@
 #include "message_handler.h"
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
 #include <unistd.h>
 #include <cstring>
 #include <iostream>
 #include <vector>
 #include <memory>
 #include <stdexcept>
+#include <algorithm>
+#include <atomic>
 
 namespace raft {
 
 // 从socket读取数据，尝试提取完整的Raft消息
-std::pair<bool, std::vector<std::unique_ptr<Message>>> MessageHandler::readRaftMessages(int sockfd, std::string& buffer) {
-    // 分配临时缓冲区
-    char temp_buffer[raft::MAX_BUFFER_SIZE];
-    
-    // 从socket读取数据
-    ssize_t n = recv(sockfd, temp_buffer, sizeof(temp_buffer), 0);
-    if (n <= 0) {
+std::pair<bool, std::vector<std::unique_ptr<Message>>> MessageHandler::readRaftMessages(int sockfd, ReceiveBuffer& buffer) {
+    // 读出所有可读数据
+    if (!buffer.readFrom(sockfd)) {
         return std::make_pair(false, std::vector<std::unique_ptr<Message>>());  // 连接已关闭或出错
     }
     
-    // 将新接收的数据追加到持久化缓冲区
-    buffer.append(temp_buffer, n);
-    
     // 处理标准的Raft内部消息
     try {
         auto messages = processRaftBuffer(buffer);
@@ -33,171 +30,289 @@ std::pair<bool, std::vector<std::unique_ptr<Message>>> MessageHandler::readRaftM
     }
 }
 
-// 从socket读取数据，尝试提取完整的客户端请求
-std::pair<bool, std::string> MessageHandler::readClientRequest(int sockfd, std::string& buffer) {
-    // 分配临时缓冲区
-    char temp_buffer[raft::MAX_BUFFER_SIZE];
+// 从socket读取数据，提取所有完整的客户端请求
+std::pair<bool, std::vector<std::string>> MessageHandler::readClientRequests(int sockfd, ReceiveBuffer& buffer) {
+    std::vector<std::string> requests;
     
-    // 从socket读取数据
-    ssize_t n = recv(sockfd, temp_buffer, sizeof(temp_buffer), 0);
-    if (n <= 0) {
-        return std::make_pair(false, std::string());  // 连接已关闭或出错
+    // 读出所有可读数据
+    if (!buffer.readFrom(sockfd)) {
+        return std::make_pair(false, std::move(requests));  // 连接已关闭或出错
     }
     
-    // 将新接收的数据追加到持久化缓冲区
-    buffer.append(temp_buffer, n);
-    
-    // 处理客户端请求
-    return processClientBuffer(buffer);
-}
-
-// 向socket发送一条Raft消息
-bool MessageHandler::sendRaftMessage(int sockfd, const Message& message) {
-    // 创建完整的网络消息
-    std::string network_message = message.createNetworkMessage();
-    
-    // 发送消息
-    ssize_t sent = 0;
-    size_t total_size = network_message.size();
-    
-    while (sent < static_cast<ssize_t>(total_size)) {
-        ssize_t n = send(sockfd, network_message.c_str() + sent, total_size - sent, 0);
-        if (n <= 0) {
-            return false;  // 发送失败
+    // 依次取出完整的请求，不完整的部分留在缓冲区等待后续数据
+    while (true) {
+        auto result = processClientBuffer(buffer);
+        if (!result.first) {
+            break;
         }
-        sent += n;
+        requests.push_back(std::move(result.second));
     }
     
-    return true;
+    // 缓冲区开头不是RESP请求，无法继续解析
+    if (!buffer.empty() && buffer.data()[0] != '*' && buffer.data()[0] != '$') {
+        return std::make_pair(false, std::move(requests));
+    }
+    return std::make_pair(true, std::move(requests));
 }
 
 // 处理Raft消息接收缓冲区，尝试提取完整消息
-std::vector<std::unique_ptr<Message>> MessageHandler::processRaftBuffer(std::string& buffer) {
+std::vector<std::unique_ptr<Message>> MessageHandler::processRaftBuffer(ReceiveBuffer& buffer) {
     std::vector<std::unique_ptr<Message>> messages;
     
-    while (buffer.size() >= sizeof(MessageHeader)) {
-        const MessageHeader* header = reinterpret_cast<const MessageHeader*>(buffer.data());
-        size_t message_size = sizeof(MessageHeader) + header->payload_size;
-        
-        // 检查是否有完整的消息
-        if (buffer.size() < message_size) {
-            break;  // 消息不完整，等待更多数据
-        }
+    // 先找出缓冲区中完整消息的总长度
+    const char* data = buffer.data();
+    size_t size = buffer.size();
+    size_t complete = 0;
+    MessageHeader header;
+    while (Message::decodeHeader(data + complete, size - complete, header) &&
+           size - complete - MESSAGE_HEADER_SIZE >= header.payload_size) {
+        complete += MESSAGE_HEADER_SIZE + header.payload_size;
+    }
+    if (complete == 0) {
+        return messages;  // 消息不完整，等待更多数据
+    }
+    
+    // 日志条目直接引用共享的接收缓冲区，不再拷贝
+    std::shared_ptr<const std::string> frames = buffer.share();
+    size_t base = buffer.readOffset();
+    
+    size_t offset = 0;
+    while (offset < complete) {
+        Message::decodeHeader(data + offset, complete - offset, header);
+        size_t message_size = MESSAGE_HEADER_SIZE + header.payload_size;
         
-        // 提取并解析消息
+        // 解析消息
         try {
-            std::string message_data = buffer.substr(0, message_size);
-            auto message = parseMessage(message_data);
-            messages.push_back(std::move(message));
+            messages.push_back(parseMessage(frames, base + offset, message_size));
         } catch (const std::exception& e) {
             std::cerr << "消息解析错误: " << e.what() << std::endl;
         }
         
-        // 移除已处理的消息
-        buffer.erase(0, message_size);
+        offset += message_size;
     }
     
+    buffer.consume(complete);
     return messages;
 }
 
-// 处理客户端请求接收缓冲区，尝试提取完整请求
-std::pair<bool, std::string> MessageHandler::processClientBuffer(std::string& buffer) {
+// 在[pos, size)中查找\r\n，返回\r的位置，找不到返回std::string::npos
+static size_t findCrlf(const char* data, size_t size, size_t pos) {
+    while (pos < size) {
+        const char* cr = static_cast<const char*>(memchr(data + pos, '\r', size - pos));
+        if (cr == nullptr) {
+            break;
+        }
+        pos = cr - data;
+        if (pos + 1 < size && data[pos + 1] == '\n') {
+            return pos;
+        }
+        ++pos;
+    }
+    return std::string::npos;
+}
+
+// 解析[begin, end)中的非负十进制长度，格式错误时返回false
+static bool parseLength(const char* begin, const char* end, long long& value) {
+    if (begin == end) {
+        return false;
+    }
+    value = 0;
+    for (const char* p = begin; p != end; ++p) {
+        if (*p < '0' || *p > '9' || value > (1LL << 40)) {
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+    }
+    return true;
+}
+
+// 处理客户端请求接收缓冲区，尝试提取一条完整请求
+std::pair<bool, std::string> MessageHandler::processClientBuffer(ReceiveBuffer& buffer) {
+    const char* data = buffer.data();
+    size_t size = buffer.size();
+    
     // RESP协议通常以*或$开头
-    if (buffer.empty() || (buffer[0] != '*' && buffer[0] != '$')) {
+    if (size == 0 || (data[0] != '*' && data[0] != '$')) {
         return std::make_pair(false, "");
     }
     
-    // 简单检测RESP协议是否完整 (确保包含完整的\r\n分隔符)
+    // 简单检测RESP协议是否完整 (确保包含完整的\r\n分隔符)，只移动下标不拷贝数据
     size_t pos = 0;
-    int args_count = 0;
+    long long args_count = 1;
     
-    if (buffer[0] == '*') {
+    if (data[0] == '*') {
         // 批量字符串数组
-        size_t end_pos = buffer.find("\r\n", 1);
+        size_t end_pos = findCrlf(data, size, 1);
         if (end_pos == std::string::npos) {
             return std::make_pair(false, "");  // 不完整的命令
         }
-        
-        try {
-            args_count = std::stoi(buffer.substr(1, end_pos - 1));
-        } catch (const std::exception&) {
+        if (!parseLength(data + 1, data + end_pos, args_count)) {
             return std::make_pair(false, "");  // 无效的参数计数
         }
-        
         pos = end_pos + 2;  // 跳过\r\n
-        
-        // 检查是否包含所有参数
-        for (int i = 0; i < args_count; ++i) {
-            if (pos >= buffer.length() || buffer[pos] != '$') {
-                return std::make_pair(false, "");  // 命令格式错误
-            }
-            
-            // 查找参数长度
-            end_pos = buffer.find("\r\n", pos + 1);
-            if (end_pos == std::string::npos) {
-                return std::make_pair(false, "");  // 不完整的命令
-            }
-            
-            int arg_len;
-            try {
-                arg_len = std::stoi(buffer.substr(pos + 1, end_pos - pos - 1));
-            } catch (const std::exception&) {
-                return std::make_pair(false, "");  // 无效的参数长度
-            }
-            
-            pos = end_pos + 2;  // 跳过\r\n
-            
-            // 检查参数值是否完整
-            if (pos + arg_len + 2 > buffer.length()) {
-                return std::make_pair(false, "");  // 命令不完整
-            }
-            
-            // 移动到下一个参数
-            pos += arg_len + 2;  // +2跳过\r\n
+    }
+    
+    // 检查是否包含所有参数（单个批量字符串视为一个参数）
+    for (long long i = 0; i < args_count; ++i) {
+        if (pos >= size || data[pos] != '$') {
+            return std::make_pair(false, "");  // 命令格式错误或不完整
         }
-    } else if (buffer[0] == '$') {
-        // 单个批量字符串
-        size_t end_pos = buffer.find("\r\n", 1);
+        
+        // 查找参数长度
+        size_t end_pos = findCrlf(data, size, pos + 1);
         if (end_pos == std::string::npos) {
             return std::make_pair(false, "");  // 不完整的命令
         }
         
-        int str_len;
-        try {
-            str_len = std::stoi(buffer.substr(1, end_pos - 1));
-        } catch (const std::exception&) {
-            return std::make_pair(false, "");  // 无效的字符串长度
+        long long arg_len;
+        if (!parseLength(data + pos + 1, data + end_pos, arg_len)) {
+            return std::make_pair(false, "");  // 无效的参数长度
         }
         
         pos = end_pos + 2;  // 跳过\r\n
         
-        // 检查字符串是否完整
-        if (pos + str_len + 2 > buffer.length()) {
-            return std::make_pair(false, "");  // 字符串不完整
+        // 检查参数值是否完整
+        if (pos + arg_len + 2 > size) {
+            return std::make_pair(false, "");  // 命令不完整
         }
         
-        pos += str_len + 2;  // +2跳过\r\n
+        // 移动到下一个参数
+        pos += arg_len + 2;  // +2跳过\r\n
     }
     
-    // 命令完整，返回整个缓冲区
-    std::string command = buffer.substr(0, pos);
-    buffer.erase(0, pos);  // 从缓冲区移除已处理的命令
-    return std::make_pair(true, command);
+    // 命令完整，取出命令并前移读游标
+    std::string command(data, pos);
+    buffer.consume(pos);
+    return std::make_pair(true, std::move(command));
 }
 
-// 发送客户端响应
-bool MessageHandler::sendClientResponse(int sockfd, const std::string& response) {
-    ssize_t sent = 0;
-    size_t total_size = response.size();
+// ---------- ReceiveBuffer 实现 ----------
+void ReceiveBuffer::consume(size_t n) {
+    read_ += n;
+    if (read_ == write_) {
+        // 全部解析完，游标回到开头，不需要搬移数据
+        read_ = 0;
+        write_ = 0;
+    }
+}
+
+void ReceiveBuffer::reserveWritable(size_t min_space) {
+    if (storage_.use_count() > 1) {
+        // 存储仍被已解析的消息引用，把未读数据拷到新的存储中继续写
+        auto fresh = std::make_shared<std::string>();
+        fresh->resize(std::max<size_t>(MAX_BUFFER_SIZE, size() + min_space));
+        memcpy(&(*fresh)[0], data(), size());
+        write_ = size();
+        read_ = 0;
+        storage_ = std::move(fresh);
+        return;
+    }
+    // 引用计数为1时其他线程已释放存储，之后的写入与它们之前的读取不会交错
+    std::atomic_thread_fence(std::memory_order_acquire);
     
-    while (sent < static_cast<ssize_t>(total_size)) {
-        ssize_t n = send(sockfd, response.c_str() + sent, total_size - sent, 0);
-        if (n <= 0) {
-            return false;  // 发送失败
-        }
-        sent += n;
+    if (empty() && storage_->size() > MAX_POOLED_BUFFER_SIZE) {
+        // 接收过大消息（如快照）后释放多余的内存
+        std::string(MAX_BUFFER_SIZE, '\0').swap(*storage_);
+    }
+    if (storage_->size() - write_ >= min_space) {
+        return;
     }
     
+    // 先把未读数据搬到开头，仍不够时再扩容
+    if (read_ > 0) {
+        memmove(&(*storage_)[0], data(), size());
+        write_ = size();
+        read_ = 0;
+    }
+    if (storage_->size() - write_ < min_space) {
+        storage_->resize(std::max<size_t>({MAX_BUFFER_SIZE, storage_->size() * 2, write_ + min_space}));
+    }
+}
+
+bool ReceiveBuffer::readFrom(int sockfd) {
+    while (true) {
+        reserveWritable(RECV_MIN_FREE_SPACE);
+        ssize_t n = recv(sockfd, &(*storage_)[write_], storage_->size() - write_, 0);
+        if (n > 0) {
+            write_ += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;  // 已读完
+        }
+        return false;  // 连接已关闭或出错
+    }
+}
+
+// ---------- OutboundBuffer 实现 ----------
+std::string& OutboundBuffer::tail() {
+    // 末尾块已经较大时另起一块，避免追加时搬移大量已有数据
+    if (chunks_.empty() || chunks_.back().size() >= OUTBOUND_CHUNK_SIZE) {
+        chunks_.emplace_back();
+    }
+    return chunks_.back();
+}
+
+void OutboundBuffer::appendMessage(const Message& message) {
+    std::string& chunk = tail();
+    size_t before = chunk.size();
+    message.encodeNetworkMessage(chunk);
+    bytes_ += chunk.size() - before;
+}
+
+void OutboundBuffer::appendData(std::string data) {
+    bytes_ += data.size();
+    if (data.size() >= OUTBOUND_CHUNK_SIZE) {
+        // 大块数据直接移入队列，不再拷贝
+        chunks_.push_back(std::move(data));
+        return;
+    }
+    tail().append(data);
+}
+
+bool OutboundBuffer::flush(int sockfd) {
+    while (bytes_ > 0) {
+        struct iovec iov[OUTBOUND_IOV_COUNT];
+        int iov_count = 0;
+        size_t skip = offset_;
+        for (auto it = chunks_.begin(); it != chunks_.end() && iov_count < OUTBOUND_IOV_COUNT; ++it) {
+            if (it->size() > skip) {
+                iov[iov_count].iov_base = const_cast<char*>(it->data()) + skip;
+                iov[iov_count].iov_len = it->size() - skip;
+                ++iov_count;
+            }
+            skip = 0;
+        }
+        
+        ssize_t n = writev(sockfd, iov, iov_count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // socket写满，剩余数据等可写后再发
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        
+        // 移除已写出的数据；只剩一块时保留其内存供后续消息复用
+        bytes_ -= static_cast<size_t>(n);
+        size_t written = static_cast<size_t>(n) + offset_;
+        offset_ = 0;
+        while (!chunks_.empty() && written >= chunks_.front().size()) {
+            written -= chunks_.front().size();
+            if (chunks_.size() == 1) {
+                chunks_.front().clear();
+                if (chunks_.front().capacity() > MAX_POOLED_BUFFER_SIZE) {
+                    std::string().swap(chunks_.front());
+                }
+                break;
+            }
+            chunks_.pop_front();
+        }
+        offset_ = written;
+    }
     return true;
 }
 
@@ -5,30 +5,87 @@
 #include <vector>
 #include <memory>
 #include <queue>
+#include <deque>
 #include <stdexcept>
 #include "message.h"
 #include "../include/constants.h"
 
 namespace raft {
 
+/**
+ * 连接的发送队列
+ * 连续的小消息合并写入同一块缓冲区，flush时用writev一次写出多块；
+ * socket写满时保留剩余数据，等可写后继续，不阻塞调用者
+ */
+class OutboundBuffer {
+public:
+    // 编码一条Raft消息追加到队列末尾
+    void appendMessage(const Message& message);
+    // 追加一段已编码的数据（如客户端响应）
+    void appendData(std::string data);
+    
+    // 未发送的字节数
+    size_t size() const { return bytes_; }
+    bool empty() const { return bytes_ == 0; }
+    
+    // 尽量写出队列中的数据，socket写满时返回true并保留剩余部分；返回false表示连接出错
+    bool flush(int sockfd);
+
+private:
+    // 返回可继续追加数据的末尾块
+    std::string& tail();
+
+    std::deque<std::string> chunks_;  // 待发送的数据块
+    size_t offset_ = 0;               // 第一块中已发送的字节数
+    size_t bytes_ = 0;                // 未发送的总字节数
+};
+
+/**
+ * 连接的接收缓冲区
+ * 用读写游标标记未解析的数据，解析只前移读游标；剩余空间不足时才把未读数据搬到开头或扩容，
+ * 稳定状态下接收数据不再分配内存。
+ * 底层存储可以共享给解析出的Raft消息（日志条目直接引用其中的数据），
+ * 仍被引用时下次写入改用新的存储，不会改动消息正在读取的内容
+ */
+class ReceiveBuffer {
+public:
+    // 未解析的数据
+    const char* data() const { return storage_->data() + read_; }
+    size_t size() const { return write_ - read_; }
+    bool empty() const { return read_ == write_; }
+    
+    // 丢弃开头已解析的n个字节
+    void consume(size_t n);
+    
+    // 读出socket中当前可读的全部数据（边缘触发模式下必须读到EAGAIN），返回false表示连接已关闭或出错
+    bool readFrom(int sockfd);
+    
+    // 以共享只读方式返回底层存储，data()位于其中的readOffset()处
+    std::shared_ptr<const std::string> share() const { return storage_; }
+    size_t readOffset() const { return read_; }
+
+private:
+    // 保证末尾至少有min_space字节可写
+    void reserveWritable(size_t min_space);
+
+    std::shared_ptr<std::string> storage_ = std::make_shared<std::string>();  // 底层存储，size()即容量
+    size_t read_ = 0;   // 读游标：之前的数据已解析
+    size_t write_ = 0;  // 写游标：之后的空间尚未写入
+};
+
 // 消息处理类，负责消息的封装和解析
 class MessageHandler {
 public:
     // 从socket读取数据，尝试提取完整的Raft消息
-    static std::pair<bool, std::vector<std::unique_ptr<Message>>> readRaftMessages(int sockfd, std::string& buffer);
-    // 从socket读取数据，尝试提取完整的客户端请求
-    static std::pair<bool, std::string> readClientRequest(int sockfd, std::string& buffer);
-    
-    // 向socket发送一条Raft消息
-    static bool sendRaftMessage(int sockfd, const Message& message);
-    // 向socket发送一条客户端响应
-    static bool sendClientResponse(int sockfd, const std::string& response);
+    static std::pair<bool, std::vector<std::unique_ptr<Message>>> readRaftMessages(int sockfd, ReceiveBuffer& buffer);
+    // 从socket读取数据，提取所有完整的客户端请求
+    static std::pair<bool, std::vector<std::string>> readClientRequests(int sockfd, ReceiveBuffer& buffer);
     
     
     // 处理Raft消息接收缓冲区，尝试提取完整消息
-    static std::vector<std::unique_ptr<Message>> processRaftBuffer(std::string& buffer);
-    // 处理客户端请求接收缓冲区，尝试提取完整请求
-    static std::pair<bool, std::string> processClientBuffer(std::string& buffer);
+    static std::vector<std::unique_ptr<Message>> processRaftBuffer(ReceiveBuffer& buffer);
+    // 处理客户端请求接收缓冲区，尝试提取一条完整请求
+    static std::pair<bool, std::string> processClientBuffer(ReceiveBuffer& buffer);
 };
 
 } // namespace raft
@@ -1,5 +1,6 @@
 #include "network_manager.h"
 #include <fcntl.h>
+#include <sys/socket.h>
 #include <unistd.h>
 #include <cstring>
 #include <iostream>
@@ -11,6 +12,7 @@
 #include <sstream>
 #include <regex>
 #include <set>
+#include <algorithm>
 
 namespace raft {
 
@@ -20,9 +22,7 @@ NetworkManager::NetworkManager(int node_id, const std::string& config_path)
       client_port_(0),
       raft_port_(0),
       running_(false),
-      client_listen_fd_(-1),
-      raft_listen_fd_(-1),
-      epoll_fd_(-1) {
+      raft_listen_fd_(-1) {
     
     // 初始化线程池
     // 客户端请求处理线程池 = 总线程数 - Raft消息处理线程数
@@ -126,8 +126,11 @@ bool NetworkManager::start() {
     
     running_ = true;
     
-    // 启动网络事件处理线程
-    network_thread_ = std::thread(&NetworkManager::networkLoop, this);
+    // 启动所有事件循环线程
+    for (auto& reactor : reactors_) {
+        Reactor* r = reactor.get();
+        r->thread = std::thread([this, r]() { networkLoop(*r); });
+    }
     
     // 尝试连接到其他节点
     for (const auto& peer : peers_) {
@@ -172,9 +175,11 @@ void NetworkManager::stop() {
     
     running_ = false;
     
-    // 等待线程结束
-    if (network_thread_.joinable()) {
-        network_thread_.join();
+    // 等待事件循环线程结束
+    for (auto& reactor : reactors_) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
     }
     
     // 等待重连线程结束
@@ -185,153 +190,131 @@ void NetworkManager::stop() {
     // 关闭所有连接
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (auto& pair : outbound_queues_) {
+            std::lock_guard<std::mutex> queue_lock(pair.second->mutex);
+            pair.second->closed = true;
+        }
         for (auto& pair : fd_types_) {
             close(pair.first);
         }
+        outbound_queues_.clear();
         fd_types_.clear();
         fd_to_node_id_.clear();
         node_id_to_fd_.clear();
     }
     
     // 关闭监听套接字和epoll
-    if (client_listen_fd_ != -1) {
-        close(client_listen_fd_);
-        client_listen_fd_ = -1;
-    }
-    
     if (raft_listen_fd_ != -1) {
         close(raft_listen_fd_);
         raft_listen_fd_ = -1;
     }
     
-    if (epoll_fd_ != -1) {
-        close(epoll_fd_);
-        epoll_fd_ = -1;
+    for (auto& reactor : reactors_) {
+        if (reactor->client_listen_fd != -1) {
+            close(reactor->client_listen_fd);
+        }
+        if (reactor->epoll_fd != -1) {
+            close(reactor->epoll_fd);
+        }
     }
+    reactors_.clear();
     
     std::cout << "Network manager stopped" << std::endl;
 }
 
-// 初始化网络
-bool NetworkManager::initNetwork() {
-    // 创建epoll实例
-    epoll_fd_ = epoll_create1(0);
-    if (epoll_fd_ == -1) {
-        std::cerr << "Failed to create epoll: " << strerror(errno) << std::endl;
-        return false;
-    }
-    
-    // 创建客户端监听socket
-    client_listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (client_listen_fd_ == -1) {
-        std::cerr << "Failed to create client socket: " << strerror(errno) << std::endl;
-        close(epoll_fd_);
-        return false;
+// 创建并监听一个端口
+int NetworkManager::createListenSocket(int port, bool reuse_port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        std::cerr << "Failed to create listen socket: " << strerror(errno) << std::endl;
+        return -1;
     }
     
-    // 设置socket选项
+    // 设置socket选项；多个事件循环各自监听同一客户端端口时需要SO_REUSEPORT，由内核分配新连接
     int opt = 1;
-    if (setsockopt(client_listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
-        std::cerr << "Failed to set client socket option: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(epoll_fd_);
-        return false;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1 ||
+        (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1)) {
+        std::cerr << "Failed to set listen socket option: " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
     }
     
-    // 绑定客户端端口
+    // 绑定端口
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(client_port_);
-    
-    if (bind(client_listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
-        std::cerr << "Failed to bind client socket: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(epoll_fd_);
-        return false;
-    }
-    
-    // 监听客户端连接
-    if (listen(client_listen_fd_, SOMAXCONN) == -1) {
-        std::cerr << "Failed to listen on client socket: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(epoll_fd_);
-        return false;
-    }
+    addr.sin_port = htons(port);
     
-    // 创建Raft监听socket
-    raft_listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (raft_listen_fd_ == -1) {
-        std::cerr << "Failed to create raft socket: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(epoll_fd_);
-        return false;
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        std::cerr << "Failed to bind port " << port << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
     }
     
-    // 设置socket选项
-    if (setsockopt(raft_listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
-        std::cerr << "Failed to set raft socket option: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(raft_listen_fd_);
-        close(epoll_fd_);
-        return false;
+    // 开始监听
+    if (listen(fd, SOMAXCONN) == -1) {
+        std::cerr << "Failed to listen on port " << port << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
     }
     
-    // 绑定Raft端口
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(raft_port_);
-    
-    if (bind(raft_listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
-        std::cerr << "Failed to bind raft socket: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(raft_listen_fd_);
-        close(epoll_fd_);
+    return fd;
+}
+
+// 把描述符加入epoll
+bool NetworkManager::addToEpoll(int epoll_fd, int fd, uint32_t events) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        std::cerr << "Failed to add socket to epoll: " << strerror(errno) << std::endl;
         return false;
     }
-    
-    // 监听Raft连接
-    if (listen(raft_listen_fd_, SOMAXCONN) == -1) {
-        std::cerr << "Failed to listen on raft socket: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(raft_listen_fd_);
-        close(epoll_fd_);
-        return false;
+    return true;
+}
+
+// 初始化网络
+bool NetworkManager::initNetwork() {
+    // 创建事件循环：CLIENT_REACTOR_COUNT个客户端循环，另加一个Raft专用循环（启用时）
+    int reactor_count = std::max(1, CLIENT_REACTOR_COUNT) + (RAFT_DEDICATED_REACTOR ? 1 : 0);
+    for (int i = 0; i < reactor_count; ++i) {
+        auto reactor = std::make_unique<Reactor>();
+        reactor->epoll_fd = epoll_create1(0);
+        if (reactor->epoll_fd == -1) {
+            std::cerr << "Failed to create epoll: " << strerror(errno) << std::endl;
+            return false;
+        }
+        reactors_.push_back(std::move(reactor));
     }
     
-    // 将监听socket添加到epoll
-    struct epoll_event ev;
-    ev.events = EPOLLIN;
-    ev.data.fd = client_listen_fd_;
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_listen_fd_, &ev) == -1) {
-        std::cerr << "Failed to add client socket to epoll: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(raft_listen_fd_);
-        close(epoll_fd_);
-        return false;
+    // 每个客户端循环各自监听客户端端口
+    bool reuse_port = std::max(1, CLIENT_REACTOR_COUNT) > 1;
+    for (int i = 0; i < std::max(1, CLIENT_REACTOR_COUNT); ++i) {
+        Reactor& reactor = *reactors_[i];
+        reactor.client_listen_fd = createListenSocket(client_port_, reuse_port);
+        if (reactor.client_listen_fd == -1 || !addToEpoll(reactor.epoll_fd, reactor.client_listen_fd, EPOLLIN)) {
+            return false;
+        }
     }
     
-    ev.data.fd = raft_listen_fd_;
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, raft_listen_fd_, &ev) == -1) {
-        std::cerr << "Failed to add raft socket to epoll: " << strerror(errno) << std::endl;
-        close(client_listen_fd_);
-        close(raft_listen_fd_);
-        close(epoll_fd_);
+    // Raft监听端口由Raft循环负责
+    raft_listen_fd_ = createListenSocket(raft_port_, false);
+    if (raft_listen_fd_ == -1 || !addToEpoll(raftReactor().epoll_fd, raft_listen_fd_, EPOLLIN)) {
         return false;
     }
     
+    std::cout << "Network initialized with " << reactors_.size() << " event loops"
+              << (RAFT_DEDICATED_REACTOR ? " (one dedicated to Raft)" : "") << std::endl;
     return true;
 }
 
 // 网络事件循环
-void NetworkManager::networkLoop() {
-    const int MAX_EVENTS = 32;
-    struct epoll_event events[MAX_EVENTS];
+void NetworkManager::networkLoop(Reactor& reactor) {
+    struct epoll_event events[MAX_EVENT];
     
     while (running_) {
-        int nfds = epoll_wait(epoll_fd_, events, MAX_EVENTS, 100); // 100ms超时
+        int nfds = epoll_wait(reactor.epoll_fd, events, MAX_EVENT, EPOLL_TIMEOUT_MS);
         
         if (nfds == -1) {
             if (errno != EINTR) { // 忽略被信号中断的情况
@@ -343,25 +326,31 @@ void NetworkManager::networkLoop() {
         for (int i = 0; i < nfds; i++) {
             int fd = events[i].data.fd;
             
-            if (fd == client_listen_fd_) {
+            if (fd == reactor.client_listen_fd) {
                 // 有新的客户端连接
-                handleNewConnection(fd, PortType::CLIENT);
+                handleNewConnection(reactor, fd, PortType::CLIENT);
             } else if (fd == raft_listen_fd_) {
                 // 有新的Raft节点连接
-                handleNewConnection(fd, PortType::RAFT);
-            } else if (events[i].events & EPOLLIN) {
-                // 可读事件
-                processSocketData(fd);
-            } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
-                // 连接断开或错误
-                closeConnection(fd);
+                handleNewConnection(reactor, fd, PortType::RAFT);
+            } else {
+                if (events[i].events & EPOLLOUT) {
+                    // 可写事件，继续发送队列中的数据
+                    handleWritable(fd);
+                }
+                if (events[i].events & EPOLLIN) {
+                    // 可读事件
+                    processSocketData(fd);
+                } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    // 连接断开或错误
+                    closeConnection(fd);
+                }
             }
         }
     }
 }
 
 // 处理新连接
-bool NetworkManager::handleNewConnection(int listen_fd, PortType port_type) {
+bool NetworkManager::handleNewConnection(Reactor& reactor, int listen_fd, PortType port_type) {
     struct sockaddr_in addr;
     socklen_t addr_len = sizeof(addr);
     
@@ -379,20 +368,16 @@ bool NetworkManager::handleNewConnection(int listen_fd, PortType port_type) {
         return false;
     }
     
-    // 添加到epoll
-    struct epoll_event ev;
-    ev.events = EPOLLIN;
-    ev.data.fd = fd;
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
-        std::cerr << "Failed to add socket to epoll: " << strerror(errno) << std::endl;
-        close(fd);
+    // 先记录连接再加入epoll（边缘触发），保证事件到达时已能找到连接；连接固定由接受它的事件循环处理
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        registerConnection(fd, port_type, reactor.epoll_fd);
+    }
+    if (!addToEpoll(reactor.epoll_fd, fd, EPOLLIN | EPOLLET)) {
+        closeConnection(fd);
         return false;
     }
     
-    // 记录连接信息
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    fd_types_[fd] = port_type;
-    
     char ip_str[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &addr.sin_addr, ip_str, sizeof(ip_str));
     std::cout << "New connection from " << ip_str << ":" << ntohs(addr.sin_port)
@@ -404,8 +389,9 @@ bool NetworkManager::handleNewConnection(int listen_fd, PortType port_type) {
 // 处理socket数据
 bool NetworkManager::processSocketData(int fd) {
     PortType port_type;
+    ReceiveBuffer* buffer_ptr = nullptr;
     
-    // 获取连接类型
+    // 获取连接类型和接收缓冲区（缓冲区只由该连接所属的事件循环访问，元素地址在unordered_map中保持不变）
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
         auto it = fd_types_.find(fd);
@@ -413,24 +399,23 @@ bool NetworkManager::processSocketData(int fd) {
             return false;
         }
         port_type = it->second;
+        buffer_ptr = &receive_buffers_[fd];
     }
-    
-    // 获取或创建此连接的接收缓冲区
-    auto& buffer = receive_buffers_[fd];
+    auto& buffer = *buffer_ptr;
     
     if (port_type == PortType::CLIENT) {
         // 处理客户端请求
-        auto result = MessageHandler::readClientRequest(fd, buffer);
+        auto result = MessageHandler::readClientRequests(fd, buffer);
+        
+        // 异步处理所有完整的请求
+        for (auto& request : result.second) {
+            asyncProcessClientRequest(fd, std::move(request));
+        }
+        
         if (!result.first) {
             closeConnection(fd);
             return false;
         }
-        
-        const std::string& request = result.second;
-        if (!request.empty()) {
-            // 异步处理客户端请求
-            asyncProcessClientRequest(fd, request);
-        }
     } else {
         // 处理Raft消息
         auto result = MessageHandler::readRaftMessages(fd, buffer);
@@ -470,6 +455,24 @@ bool NetworkManager::processSocketData(int fd) {
                     const auto& response = static_cast<const AppendEntriesResponse&>(*message);
                     from_node_id = response.follower_id;
                 }
+                // 如果是InstallSnapshot请求/响应，分别取leader_id/follower_id
+                else if (message->getType() == MessageType::INSTALLSNAPSHOT_REQUEST) {
+                    const auto& request = static_cast<const InstallSnapshotRequest&>(*message);
+                    from_node_id = request.leader_id;
+                }
+                else if (message->getType() == MessageType::INSTALLSNAPSHOT_RESPONSE) {
+                    const auto& response = static_cast<const InstallSnapshotResponse&>(*message);
+                    from_node_id = response.follower_id;
+                }
+                // 如果是ReadIndex请求/响应，分别取follower_id/leader_id
+                else if (message->getType() == MessageType::READINDEX_REQUEST) {
+                    const auto& request = static_cast<const ReadIndexRequest&>(*message);
+                    from_node_id = request.follower_id;
+                }
+                else if (message->getType() == MessageType::READINDEX_RESPONSE) {
+                    const auto& response = static_cast<const ReadIndexResponse&>(*message);
+                    from_node_id = response.leader_id;
+                }
                 
                 // 如果能够确定节点ID，更新映射
                 if (from_node_id > 0) {
@@ -491,6 +494,10 @@ bool NetworkManager::processSocketData(int fd) {
 
 // 连接到对等节点
 bool NetworkManager::connectToPeer(int node_id) {
+    if (!running_) {
+        return false;  // 网络未启动或已停止，事件循环不可用
+    }
+    
     // 找到对应节点的配置
     NodeConfig* peer_config = getPeerConfig(node_id);
     if (!peer_config) {
@@ -568,24 +575,21 @@ bool NetworkManager::connectToPeer(int node_id) {
         }
     }
     
-    // 添加到epoll
-    struct epoll_event ev;
-    ev.events = EPOLLIN;
-    ev.data.fd = fd;
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
-        std::cerr << "Failed to add socket to epoll: " << strerror(errno) << std::endl;
-        close(fd);
-        return false;
-    }
-    
-    // 添加连接信息
+    // 添加连接信息，由Raft事件循环处理
+    int epoll_fd = raftReactor().epoll_fd;
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
-        fd_types_[fd] = PortType::RAFT;
+        registerConnection(fd, PortType::RAFT, epoll_fd);
         fd_to_node_id_[fd] = node_id;
         node_id_to_fd_[node_id] = fd;
     }
     
+    // 添加到epoll（边缘触发）
+    if (!addToEpoll(epoll_fd, fd, EPOLLIN | EPOLLET)) {
+        closeConnection(fd);
+        return false;
+    }
+    
     std::cout << "Connected to peer " << node_id << " at " << peer_config->ip
               << ":" << (peer_config->port - 1000) << std::endl;
     
@@ -598,10 +602,8 @@ void NetworkManager::closeConnection(int fd) {
         return;
     }
     
-    // 从epoll移除
-    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
-    
     // 更新连接映射
+    std::shared_ptr<OutboundQueue> queue;
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
         // 先检查是否有关联的节点ID
@@ -620,10 +622,86 @@ void NetworkManager::closeConnection(int fd) {
         
         // 清理接收缓冲区
         receive_buffers_.erase(fd);
+        
+        // 取出发送队列
+        auto it_queue = outbound_queues_.find(fd);
+        if (it_queue != outbound_queues_.end()) {
+            queue = std::move(it_queue->second);
+            outbound_queues_.erase(it_queue);
+        }
+    }
+    
+    // 丢弃客户端请求队列，正在处理的请求写回时会发现发送队列已关闭
+    {
+        std::lock_guard<std::mutex> lock(client_queue_mutex_);
+        client_queues_.erase(fd);
+    }
+    
+    // 从epoll移除
+    if (queue) {
+        epoll_ctl(queue->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    
+    // 关闭socket；持有发送队列锁关闭，保证正在发送的线程不会写到被复用的描述符上
+    if (queue) {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->closed = true;
+        close(fd);
+    } else {
+        close(fd);
+    }
+}
+
+// 记录新连接并创建其发送队列
+void NetworkManager::registerConnection(int fd, PortType port_type, int epoll_fd) {
+    fd_types_[fd] = port_type;
+    auto queue = std::make_shared<OutboundQueue>();
+    queue->epoll_fd = epoll_fd;
+    outbound_queues_[fd] = std::move(queue);
+}
+
+// 获取连接的发送队列
+std::shared_ptr<NetworkManager::OutboundQueue> NetworkManager::getOutboundQueue(int fd) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    auto it = outbound_queues_.find(fd);
+    if (it == outbound_queues_.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+// 写出发送队列，socket写满时注册EPOLLOUT，全部写出后取消
+bool NetworkManager::flushOutbound(int fd, OutboundQueue& queue) {
+    if (!queue.buffer.flush(fd)) {
+        // 发送出错：关闭读写两端，由网络线程在读到连接断开时统一清理
+        std::cerr << "Failed to send on fd " << fd << ": " << strerror(errno) << std::endl;
+        shutdown(fd, SHUT_RDWR);
+        queue.closed = true;
+        return false;
     }
     
-    // 关闭socket
-    close(fd);
+    bool want_writable = !queue.buffer.empty();
+    if (want_writable != queue.waiting_writable) {
+        struct epoll_event ev;
+        ev.events = want_writable ? (EPOLLIN | EPOLLOUT | EPOLLET) : (EPOLLIN | EPOLLET);
+        ev.data.fd = fd;
+        if (epoll_ctl(queue.epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0) {
+            queue.waiting_writable = want_writable;
+        }
+    }
+    return true;
+}
+
+// 连接可写时继续发送队列中的数据
+void NetworkManager::handleWritable(int fd) {
+    auto queue = getOutboundQueue(fd);
+    if (!queue) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->closed) {
+        flushOutbound(fd, *queue);
+    }
 }
 
 // 向指定节点发送消息
@@ -665,18 +743,26 @@ bool NetworkManager::sendMessage(int target_id, const Message& message) {
         fd = it->second;
     }
     
-    // 发送消息
-    std::lock_guard<std::mutex> lock(send_mutex_);
-    bool success = MessageHandler::sendRaftMessage(fd, message);
-    
-    // 如果发送失败，关闭连接并标记为需要重连
-    if (!success) {
-        closeConnection(fd);
-        std::lock_guard<std::mutex> lock(connections_mutex_);
-        node_id_to_fd_.erase(target_id);
+    // 编码进该连接的发送队列
+    auto queue = getOutboundQueue(fd);
+    if (!queue) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->closed) {
+        return false;
     }
+    if (queue->buffer.size() >= MAX_OUTBOUND_QUEUE_SIZE) {
+        // 对端长时间不读，丢弃本条消息，Raft会在之后重试
+        return false;
+    }
+    queue->buffer.appendMessage(message);
     
-    return success;
+    // 已在等待可写时由网络线程继续发送，否则立即尝试写出
+    if (queue->waiting_writable) {
+        return true;
+    }
+    return flushOutbound(fd, *queue);
 }
 
 // 向客户端发送响应
@@ -684,8 +770,32 @@ bool NetworkManager::sendClientResponse(int client_fd, const std::string& respon
     if (client_fd < 0) {
         return false;
     }
-    std::lock_guard<std::mutex> lock(send_mutex_);
-    return MessageHandler::sendClientResponse(client_fd, response);
+    auto queue = getOutboundQueue(client_fd);
+    if (!queue) {
+        return false;
+    }
+    return appendClientResponse(client_fd, *queue, response);
+}
+
+// 把响应追加到发送队列并尝试写出
+bool NetworkManager::appendClientResponse(int client_fd, OutboundQueue& queue, const std::string& response) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.closed) {
+        return false;
+    }
+    queue.buffer.appendData(response);
+    if (queue.buffer.size() > MAX_OUTBOUND_QUEUE_SIZE) {
+        // 客户端长时间不读取响应，断开连接
+        std::cerr << "Client fd " << client_fd << " output buffer overflow, closing" << std::endl;
+        shutdown(client_fd, SHUT_RDWR);
+        queue.closed = true;
+        return false;
+    }
+    
+    if (queue.waiting_writable) {
+        return true;
+    }
+    return flushOutbound(client_fd, queue);
 }
 
 // 获取节点配置
@@ -699,46 +809,142 @@ NodeConfig* NetworkManager::getPeerConfig(int node_id) {
 }
 
 // 异步处理客户端请求
-void NetworkManager::asyncProcessClientRequest(int client_fd, const std::string& request) {
-    // 将请求处理任务提交到线程池
-    thread_pool_->enqueue([this, client_fd, request]() {
-        // 在工作线程中处理请求
+void NetworkManager::asyncProcessClientRequest(int client_fd, std::string request) {
+    auto output = getOutboundQueue(client_fd);
+    if (!output) {
+        return;
+    }
+    
+    // 放入该连接的请求队列，队列空闲时提交一个处理任务
+    std::shared_ptr<ClientRequestQueue> queue;
+    {
+        std::lock_guard<std::mutex> lock(client_queue_mutex_);
+        auto& slot = client_queues_[client_fd];
+        if (!slot || slot->output != output) {
+            slot = std::make_shared<ClientRequestQueue>();
+            slot->output = std::move(output);
+        }
+        slot->requests.push_back(std::move(request));
+        if (slot->scheduled) {
+            return;
+        }
+        slot->scheduled = true;
+        queue = slot;
+    }
+    thread_pool_->enqueue([this, queue, client_fd]() {
+        drainClientRequests(queue, client_fd);
+    });
+}
+
+// 依次提交某个连接的请求，按请求顺序写回响应
+void NetworkManager::drainClientRequests(const std::shared_ptr<ClientRequestQueue>& queue, int client_fd) {
+    std::deque<std::future<std::string>> pending;  // 已提交、尚未写回响应的请求
+    
+    // 按顺序写回响应：先等待最早的wait_count条，之后只写回已就绪的；多条响应合并为一次写出
+    auto reply = [&](size_t wait_count) {
+        std::string out;
+        while (!pending.empty()) {
+            if (wait_count == 0 &&
+                pending.front().wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                break;
+            }
+            if (wait_count > 0) {
+                --wait_count;
+            }
+            try {
+                out += pending.front().get();
+            } catch (const std::exception& e) {
+                std::cerr << "Error processing client request: " << e.what() << std::endl;
+                out += "-ERR Internal server error\r\n";
+            }
+            pending.pop_front();
+        }
+        if (!out.empty()) {
+            appendClientResponse(client_fd, *queue->output, out);
+        }
+    };
+    std::function<void()> wait_previous = [&]() { reply(pending.size()); };
+    
+    while (true) {
+        std::string request;
+        {
+            std::lock_guard<std::mutex> lock(client_queue_mutex_);
+            if (queue->requests.empty() && pending.empty()) {
+                queue->scheduled = false;
+                return;
+            }
+            if (!queue->requests.empty()) {
+                request = std::move(queue->requests.front());
+                queue->requests.pop_front();
+            }
+        }
+        
+        if (request.empty()) {
+            // 没有新请求：写回最早的一条响应后再检查是否有新到达的请求
+            reply(1);
+            continue;
+        }
+        
+        // 在工作线程中提交请求
         if (client_request_callback_) {
             try {
-                std::string response = client_request_callback_(client_fd, request);
-                if (!response.empty()) {
-                    sendClientResponse(client_fd, response);
-                }
+                pending.push_back(client_request_callback_(client_fd, request, wait_previous));
             } catch (const std::exception& e) {
                 std::cerr << "Error processing client request: " << e.what() << std::endl;
-                // 发送错误响应
-                sendClientResponse(client_fd, "-ERR Internal server error\r\n");
+                pending.push_back(makeReadyResponse("-ERR Internal server error\r\n"));
             }
         }
-    });
+        reply(0);
+    }
 }
 
 // 异步处理Raft消息
 void NetworkManager::asyncProcessRaftMessage(int fd, int from_node_id, std::unique_ptr<Message> message) {
-    // 创建消息的副本，因为我们需要将其移动到lambda中
-    Message* msg_ptr = message.release();
-    
-    // 将消息处理任务提交到线程池
-    raft_thread_pool_->enqueue([this, fd, from_node_id, msg_ptr]() {
-        // 在工作线程中处理消息
-        std::unique_ptr<Message> msg(msg_ptr); // 重新获取所有权
+    (void)fd;
+    // 放入该节点发给该组的消息队列，队列空闲时提交一个处理任务；不同组的消息互不阻塞
+    int group_id = message->group_id;
+    {
+        std::lock_guard<std::mutex> lock(raft_queue_mutex_);
+        RaftMessageQueue& queue = raft_queues_[{from_node_id, group_id}];
+        queue.messages.push_back(std::move(message));
+        if (queue.scheduled) {
+            return;
+        }
+        queue.scheduled = true;
+    }
+    raft_thread_pool_->enqueue([this, from_node_id, group_id]() {
+        drainRaftMessages(from_node_id, group_id);
+    });
+}
+
+// 依次处理某个节点发给某个组的消息队列
+void NetworkManager::drainRaftMessages(int from_node_id, int group_id) {
+    while (true) {
+        std::unique_ptr<Message> msg;
+        {
+            std::lock_guard<std::mutex> lock(raft_queue_mutex_);
+            RaftMessageQueue& queue = raft_queues_[{from_node_id, group_id}];
+            if (queue.messages.empty()) {
+                queue.scheduled = false;
+                return;
+            }
+            msg = std::move(queue.messages.front());
+            queue.messages.pop_front();
+        }
         
+        // 在工作线程中处理消息
         if (message_callback_) {
             try {
                 auto response = message_callback_(from_node_id, *msg);
                 if (response) {
+                    response->group_id = msg->group_id;
                     sendMessage(from_node_id, *response);
                 }
             } catch (const std::exception& e) {
                 std::cerr << "Error processing Raft message: " << e.what() << std::endl;
             }
         }
-    });
+    }
 }
 
-} // namespace raft 
\ No newline at end of file
+} // namespace raft 
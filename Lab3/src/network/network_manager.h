@@ -7,7 +7,10 @@
 #include <atomic>
 #include <mutex>
 #include <unordered_map>
+#include <map>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
 #include <sys/epoll.h>
 #include <netinet/in.h>
@@ -35,7 +38,17 @@ struct NodeConfig {
 // 消息处理回调函数类型
 using MessageCallback = std::function<std::unique_ptr<Message>(int from_node_id, const Message& message)>;
 // 客户端请求处理回调函数类型
-using ClientRequestCallback = std::function<std::string(int client_fd, const std::string& request)>;
+// 返回响应的future，可以在命令生效前返回（如已排队写入日志的命令），同一连接的下一条请求随即提交；
+// wait_previous等待同一连接之前的请求全部完成，需要看到之前写入结果的命令（如读）在执行前调用
+using ClientRequestCallback = std::function<std::future<std::string>(int client_fd, const std::string& request,
+                                                                      const std::function<void()>& wait_previous)>;
+
+// 构造已就绪的响应
+inline std::future<std::string> makeReadyResponse(std::string response) {
+    std::promise<std::string> promise;
+    promise.set_value(std::move(response));
+    return promise.get_future();
+}
 
 /**
  * NetworkManager类 - 负责处理所有网络通信
@@ -106,11 +119,11 @@ public:
     int getClusterSize() const { return 1 + peers_.size(); }
 
     /**
-     * 异步处理客户端请求
+     * 异步处理客户端请求，同一连接的请求按到达顺序提交，响应按请求顺序写回
      * @param client_fd 客户端连接描述符
      * @param request 请求内容
      */
-    void asyncProcessClientRequest(int client_fd, const std::string& request);
+    void asyncProcessClientRequest(int client_fd, std::string request);
 
     /**
      * 异步处理Raft消息
@@ -129,37 +142,78 @@ private:
     
     // 网络状态
     std::atomic<bool> running_;                    // 是否正在运行
-    int client_listen_fd_;                         // 客户端监听套接字
     int raft_listen_fd_;                           // Raft内部通信监听套接字
-    int epoll_fd_;                                 // epoll文件描述符
+    
+    // 事件循环：每个循环有自己的epoll和线程，连接建立后固定由一个循环处理
+    struct Reactor {
+        int epoll_fd = -1;                         // epoll文件描述符
+        int client_listen_fd = -1;                 // 本循环的客户端监听套接字（SO_REUSEPORT共享端口），-1表示不接受客户端
+        std::thread thread;                        // 事件循环线程
+    };
+    std::vector<std::unique_ptr<Reactor>> reactors_; // 前CLIENT_REACTOR_COUNT个处理客户端，启用RAFT_DEDICATED_REACTOR时最后一个只处理Raft
+    Reactor& raftReactor() { return *reactors_.back(); } // 负责Raft监听和节点连接的事件循环
     
     // 连接管理
     std::mutex connections_mutex_;                 // 连接互斥锁
     std::unordered_map<int, PortType> fd_types_;   // 文件描述符到端口类型的映射
     std::unordered_map<int, int> fd_to_node_id_;   // 文件描述符到节点ID的映射
     std::unordered_map<int, int> node_id_to_fd_;   // 节点ID到文件描述符的映射
-    std::unordered_map<int, std::string> receive_buffers_; // 文件描述符到接收缓冲区的映射
+    std::unordered_map<int, ReceiveBuffer> receive_buffers_; // 文件描述符到接收缓冲区的映射
+    
+    // 每个连接的发送队列；发送线程只锁自己的连接，慢连接不影响其他连接
+    struct OutboundQueue {
+        std::mutex mutex;                          // 保护以下字段
+        OutboundBuffer buffer;                     // 未发送的数据
+        int epoll_fd = -1;                         // 连接所属事件循环的epoll
+        bool waiting_writable = false;             // 是否已注册EPOLLOUT，等待网络线程继续发送
+        bool closed = false;                       // 连接已关闭，不再写入
+    };
+    std::unordered_map<int, std::shared_ptr<OutboundQueue>> outbound_queues_; // 文件描述符到发送队列的映射
     
     // 回调函数
     MessageCallback message_callback_;             // 消息处理回调
     ClientRequestCallback client_request_callback_;// 客户端请求处理回调
     
     // 线程
-    std::thread network_thread_;                   // 网络事件处理线程
     std::thread reconnect_thread_;                 // 重连线程
-    std::mutex send_mutex_;                        // 发送锁
 
     // 线程池
     std::unique_ptr<ThreadPool> thread_pool_;      // 客户端请求处理线程池
     std::unique_ptr<ThreadPool> raft_thread_pool_; // Raft消息处理线程池
+
+    // 同一节点发来的Raft消息按到达顺序串行处理（leader会流水线发送AppendEntries）
+    struct RaftMessageQueue {
+        std::deque<std::unique_ptr<Message>> messages; // 待处理的消息
+        bool scheduled = false;                        // 是否已有线程在处理该队列
+    };
+    std::map<std::pair<int, int>, RaftMessageQueue> raft_queues_; // (节点ID, 组ID)到消息队列的映射
+    std::mutex raft_queue_mutex_;                  // 保护raft_queues_
+    void drainRaftMessages(int from_node_id, int group_id); // 依次处理某个节点发给某个组的消息队列
+    
+    // 同一客户端连接的请求按到达顺序提交，前一条不必完成即可提交下一条（流水线中的写命令可合并为一条日志），响应按请求顺序写回
+    struct ClientRequestQueue {
+        std::deque<std::string> requests;              // 待提交的请求
+        bool scheduled = false;                        // 是否已有线程在处理该队列
+        std::shared_ptr<OutboundQueue> output;         // 该连接的发送队列，响应只写入它，不会写到复用同一描述符的新连接
+    };
+    std::unordered_map<int, std::shared_ptr<ClientRequestQueue>> client_queues_; // 文件描述符到请求队列的映射
+    std::mutex client_queue_mutex_;                // 保护client_queues_和各队列的requests、scheduled
+    void drainClientRequests(const std::shared_ptr<ClientRequestQueue>& queue, int client_fd); // 依次提交某个连接的请求并按序写回响应
     
     // 私有辅助方法
     bool parseConfig(const std::string& config_path);  // 解析配置文件
     bool initNetwork();                            // 初始化网络
-    void networkLoop();                            // 网络事件循环
-    bool handleNewConnection(int listen_fd, PortType port_type);  // 处理新连接
+    int createListenSocket(int port, bool reuse_port); // 创建并监听一个端口，失败返回-1
+    bool addToEpoll(int epoll_fd, int fd, uint32_t events); // 把描述符加入epoll
+    void networkLoop(Reactor& reactor);            // 网络事件循环
+    bool handleNewConnection(Reactor& reactor, int listen_fd, PortType port_type);  // 处理新连接
     bool processSocketData(int fd);                // 处理socket数据
     bool connectToPeer(int node_id);               // 连接到对等节点
+    void registerConnection(int fd, PortType port_type, int epoll_fd); // 记录新连接并创建其发送队列，调用者需持有connections_mutex_
+    std::shared_ptr<OutboundQueue> getOutboundQueue(int fd); // 获取连接的发送队列，连接不存在时返回空
+    bool flushOutbound(int fd, OutboundQueue& queue); // 写出发送队列，写满时注册EPOLLOUT，调用者需持有queue.mutex
+    void handleWritable(int fd);                   // 连接可写时继续发送队列中的数据
+    bool appendClientResponse(int client_fd, OutboundQueue& queue, const std::string& response); // 把响应追加到发送队列并尝试写出
     void closeConnection(int fd);                  // 关闭连接
     NodeConfig* getPeerConfig(int node_id);        // 获取节点配置
     int getClientPort() const { return client_port_; } // 获取客户端端口
@@ -1,29 +1,674 @@
 #include "kv_store.h"
+#include "../utils/tools.h"
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
 
 namespace raft {
 
+// 一次分配在glibc malloc中的实际占用：请求大小加8字节头部，按16字节对齐，最小32字节
+static size_t allocationBytes(size_t size) {
+    size_t chunk = (size + sizeof(size_t) + 15) & ~static_cast<size_t>(15);
+    return std::max<size_t>(chunk, 32);
+}
+
+// 哈希表节点：next指针、元素和缓存的哈希值，另加一个桶指针
+template <typename Element>
+static size_t hashNodeBytes() {
+    return allocationBytes(sizeof(void*) + sizeof(Element) + sizeof(size_t)) + sizeof(void*);
+}
+
+// 红黑树节点：颜色和三个指针共32字节，加上元素
+static const size_t INDEX_NODE_BYTES = allocationBytes(32 + sizeof(std::string_view));
+static const size_t EXPIRY_BYTES = hashNodeBytes<std::pair<const std::string_view, int64_t>>();
+
+// 本线程的随机数发生器，用于淘汰采样和LFU计数
+static std::mt19937_64& randomEngine() {
+    thread_local std::mt19937_64 engine(std::random_device{}());
+    return engine;
+}
+
+void KVStore::Value::store(std::string_view data) {
+    size_ = static_cast<uint32_t>(data.size());
+    if (size_ <= INLINE_SIZE) {
+        std::memcpy(inline_, data.data(), size_);
+    } else {
+        heap_ = static_cast<char*>(std::malloc(size_));
+        std::memcpy(heap_, data.data(), size_);
+    }
+}
+
+void KVStore::Value::release() {
+    if (size_ > INLINE_SIZE) {
+        std::free(heap_);
+    }
+    size_ = 0;
+}
+
+void KVStore::Value::assign(std::string_view data) {
+    if (data.size() == size_) {
+        // 长度不变时原地覆盖
+        std::memcpy(size_ <= INLINE_SIZE ? inline_ : heap_, data.data(), size_);
+        return;
+    }
+    release();
+    store(data);
+}
+
+size_t KVStore::Value::heapBytes() const {
+    return size_ > INLINE_SIZE ? allocationBytes(size_) : 0;
+}
+
+size_t KVStore::Shard::entryBytes(const std::string& key, const Value& value) {
+    size_t bytes = hashNodeBytes<Store::value_type>() + INDEX_NODE_BYTES + value.heapBytes();
+    // 短键存放在std::string对象内部，长键另有一次分配
+    const char* object = reinterpret_cast<const char*>(&key);
+    if (key.data() < object || key.data() >= object + sizeof(std::string)) {
+        bytes += allocationBytes(key.capacity() + 1);
+    }
+    return bytes;
+}
+
+KVStore::Store::iterator KVStore::Shard::put(const std::string& key, std::string_view value) {
+    auto it = store.find(key);
+    if (it == store.end()) {
+        it = store.try_emplace(key, value).first;
+        index.insert(it->first);
+        used_bytes.fetch_add(entryBytes(it->first, it->second), std::memory_order_relaxed);
+        return it;
+    }
+    size_t old_bytes = it->second.heapBytes();
+    it->second.assign(value);
+    used_bytes.fetch_add(it->second.heapBytes() - old_bytes, std::memory_order_relaxed);
+    clearExpiry(it->first);
+    return it;
+}
+
+const KVStore::Value* KVStore::Shard::find(const std::string& key, int64_t now) const {
+    auto it = store.find(key);
+    if (it == store.end() || expired(it->first, now)) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void KVStore::Shard::setExpiry(std::string_view key, int64_t expire_at) {
+    auto result = expires.insert_or_assign(key, expire_at);
+    if (result.second) {
+        used_bytes.fetch_add(EXPIRY_BYTES, std::memory_order_relaxed);
+    }
+}
+
+bool KVStore::Shard::clearExpiry(std::string_view key) {
+    if (expires.empty() || expires.erase(key) == 0) {
+        return false;
+    }
+    used_bytes.fetch_sub(EXPIRY_BYTES, std::memory_order_relaxed);
+    return true;
+}
+
+bool KVStore::Shard::expired(std::string_view key, int64_t now) const {
+    if (expires.empty()) {
+        return false;
+    }
+    auto it = expires.find(key);
+    return it != expires.end() && it->second <= now;
+}
+
+bool KVStore::Shard::erase(const std::string& key) {
+    auto it = store.find(key);
+    if (it == store.end()) {
+        return false;
+    }
+    // 先移除指向该节点键的视图，再释放节点
+    index.erase(std::string_view(it->first));
+    clearExpiry(it->first);
+    used_bytes.fetch_sub(entryBytes(it->first, it->second), std::memory_order_relaxed);
+    store.erase(it);
+    return true;
+}
+
+size_t KVStore::shardIndex(const std::string& key) const {
+    return std::hash<std::string>{}(key) % KV_SHARD_COUNT;
+}
+
+KVStore::Shard& KVStore::shardFor(const std::string& key) {
+    return shards_[shardIndex(key)];
+}
+
+template <typename T, typename KeyOf>
+std::array<std::vector<size_t>, KV_SHARD_COUNT> KVStore::groupByShard(const std::vector<T>& items, KeyOf key_of) const {
+    std::array<std::vector<size_t>, KV_SHARD_COUNT> groups;
+    for (size_t i = 0; i < items.size(); ++i) {
+        groups[shardIndex(key_of(items[i]))].push_back(i);
+    }
+    return groups;
+}
+
+std::array<std::vector<size_t>, KV_SHARD_COUNT> KVStore::groupKeysByShard(const std::vector<std::string>& args, size_t stride) const {
+    std::array<std::vector<size_t>, KV_SHARD_COUNT> groups;
+    for (size_t i = 0; i < args.size(); i += stride) {
+        groups[shardIndex(args[i])].push_back(i);
+    }
+    return groups;
+}
+
+template <typename Lock>
+std::vector<Lock> KVStore::lockShards(const std::array<std::vector<size_t>, KV_SHARD_COUNT>& groups) {
+    // 与snapshot/restore一样按分片下标递增加锁，不会死锁
+    std::vector<Lock> locks;
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        if (!groups[s].empty()) {
+            locks.emplace_back(shards_[s].mtx);
+        }
+    }
+    return locks;
+}
+
+// LFU计数按未访问的时间衰减后的值；access可能被并发的读者写成比now稍晚的时间，按有符号差计算
+static uint32_t lfuCounter(uint32_t access, int64_t now) {
+    uint16_t minutes = static_cast<uint16_t>(now / 60000);
+    int idle = static_cast<int16_t>(static_cast<uint16_t>(minutes - (access >> 8)));
+    uint32_t counter = access & 0xff;
+    uint32_t decay = idle > 0 ? static_cast<uint32_t>(idle / LFU_DECAY_MINUTES) : 0;
+    return counter > decay ? counter - decay : 0;
+}
+
+void KVStore::touch(const Value& value, int64_t now) const {
+    if (policy_ == EvictionPolicy::ALLKEYS_LRU) {
+        value.access.store(static_cast<uint32_t>(now / LRU_CLOCK_RESOLUTION_MS), std::memory_order_relaxed);
+    } else if (policy_ == EvictionPolicy::ALLKEYS_LFU) {
+        // 先按未访问的时间衰减，再以随计数增大而减小的概率加1，8位计数可以区分很大范围的访问频率
+        uint32_t counter = lfuCounter(value.access.load(std::memory_order_relaxed), now);
+        if (counter < 255) {
+            double base = counter > static_cast<uint32_t>(LFU_INIT_COUNTER) ? counter - LFU_INIT_COUNTER : 0;
+            std::uniform_real_distribution<double> dist(0.0, 1.0);
+            if (dist(randomEngine()) < 1.0 / (base * LFU_LOG_FACTOR + 1)) {
+                ++counter;
+            }
+        }
+        uint32_t minutes = static_cast<uint16_t>(now / 60000);
+        value.access.store((minutes << 8) | counter, std::memory_order_relaxed);
+    }
+}
+
+uint64_t KVStore::evictionScore(const Shard& shard, const Store::value_type& entry, int64_t now) const {
+    if (shard.expired(entry.first, now)) {
+        return UINT64_MAX;  // 已过期的键最先淘汰
+    }
+    uint32_t access = entry.second.access.load(std::memory_order_relaxed);
+    if (policy_ == EvictionPolicy::ALLKEYS_LFU) {
+        // 计数越低越先淘汰
+        return 255 - lfuCounter(access, now);
+    }
+    // 未访问的时间越长越先淘汰；按有符号差计算，时钟回绕或并发的读者记录了比now稍晚的时间时仍然正确
+    int32_t idle = static_cast<int32_t>(static_cast<uint32_t>(now / LRU_CLOCK_RESOLUTION_MS) - access);
+    return idle > 0 ? static_cast<uint64_t>(idle) : 0;
+}
+
 std::string KVStore::get(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    auto it = store_.find(key);
-    if (it == store_.end()) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    int64_t now = currentTimeMs();
+    const Value* value = shard.find(key, now);
+    if (!value) {
         return "";
     }
-    return it->second;
+    touch(*value, now);
+    return std::string(value->view());
+}
+
+int64_t KVStore::ttlMs(const std::string& key) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    int64_t now = currentTimeMs();
+    if (!shard.find(key, now)) {
+        return -2;
+    }
+    auto it = shard.expires.find(key);
+    return it == shard.expires.end() ? -1 : it->second - now;
+}
+
+int64_t KVStore::expireAt(const std::string& key) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.expires.find(key);
+    return it == shard.expires.end() ? -1 : it->second;
+}
+
+void KVStore::forEachExpiry(const std::function<void(const std::string& key, int64_t expire_at)>& fn) {
+    for (auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        for (const auto& entry : shard.expires) {
+            fn(std::string(entry.first), entry.second);
+        }
+    }
 }
 
 void KVStore::set(const std::string& key, const std::string& value) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    store_[key] = value;
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    touch(shard.put(key, value)->second, currentTimeMs());
 }
 
 void KVStore::del(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    store_.erase(key);
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    shard.erase(key);
+}
+
+std::vector<std::string> KVStore::multiGet(const std::vector<std::string>& keys) {
+    std::vector<std::string> values(keys.size());
+    auto groups = groupKeysByShard(keys, 1);
+    auto locks = lockShards<std::shared_lock<std::shared_mutex>>(groups);
+    int64_t now = currentTimeMs();
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        for (size_t i : groups[s]) {
+            if (const Value* value = shards_[s].find(keys[i], now)) {
+                touch(*value, now);
+                values[i] = std::string(value->view());
+            }
+        }
+    }
+    return values;
+}
+
+int KVStore::countExisting(const std::vector<std::string>& keys) {
+    int count = 0;
+    auto groups = groupKeysByShard(keys, 1);
+    auto locks = lockShards<std::shared_lock<std::shared_mutex>>(groups);
+    int64_t now = currentTimeMs();
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        for (size_t i : groups[s]) {
+            count += shards_[s].find(keys[i], now) ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+void KVStore::multiSet(const std::vector<std::pair<std::string, std::string>>& kvs) {
+    auto groups = groupByShard(kvs, [](const std::pair<std::string, std::string>& kv) -> const std::string& { return kv.first; });
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        if (groups[s].empty()) {
+            continue;
+        }
+        std::unique_lock<std::shared_mutex> lock(shards_[s].mtx);
+        // 同一个键出现多次时按顺序覆盖，最后一个生效
+        int64_t now = currentTimeMs();
+        for (size_t i : groups[s]) {
+            touch(shards_[s].put(kvs[i].first, kvs[i].second)->second, now);
+        }
+    }
+}
+
+int KVStore::multiDel(const std::vector<std::string>& keys) {
+    int deleted = 0;
+    auto groups = groupByShard(keys, [](const std::string& key) -> const std::string& { return key; });
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        if (groups[s].empty()) {
+            continue;
+        }
+        std::unique_lock<std::shared_mutex> lock(shards_[s].mtx);
+        for (size_t i : groups[s]) {
+            deleted += shards_[s].erase(keys[i]) ? 1 : 0;
+        }
+    }
+    return deleted;
+}
+
+bool KVStore::Batch::get(const std::string& key, std::string& value) const {
+    Shard& shard = store_.shardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    // 与KVStore::get一致：已过期但删除日志尚未应用的键视为不存在
+    const Value* found = shard.find(key, currentTimeMs());
+    if (!found) {
+        return false;
+    }
+    value.assign(found->view());
+    return true;
+}
+
+void KVStore::Batch::set(const std::string& key, const std::string& value) {
+    Shard& shard = store_.shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    store_.touch(shard.put(key, value)->second, currentTimeMs());
+}
+
+void KVStore::Batch::set(const std::string& key, const std::string& value, int64_t expire_at) {
+    Shard& shard = store_.shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.put(key, value);
+    store_.touch(it->second, currentTimeMs());
+    shard.setExpiry(it->first, expire_at);
+}
+
+bool KVStore::Batch::expire(const std::string& key, int64_t expire_at, int64_t now) {
+    Shard& shard = store_.shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.store.find(key);
+    if (it == shard.store.end() || shard.expired(it->first, now)) {
+        return false;
+    }
+    if (expire_at <= now) {
+        shard.erase(key);
+    } else {
+        shard.setExpiry(it->first, expire_at);
+    }
+    return true;
+}
+
+bool KVStore::Batch::persist(const std::string& key, int64_t now) {
+    Shard& shard = store_.shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.store.find(key);
+    if (it == shard.store.end() || shard.expired(it->first, now)) {
+        return false;
+    }
+    return shard.clearExpiry(it->first);
+}
+
+bool KVStore::Batch::removeExpired(const std::string& key, int64_t now) {
+    Shard& shard = store_.shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    return shard.expired(key, now) && shard.erase(key);
+}
+
+bool KVStore::Batch::del(const std::string& key) {
+    Shard& shard = store_.shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    return shard.erase(key);
+}
+
+void KVStore::Batch::multiSet(const std::vector<std::string>& keys_and_values) {
+    auto groups = store_.groupKeysByShard(keys_and_values, 2);
+    auto locks = store_.lockShards<std::unique_lock<std::shared_mutex>>(groups);
+    // 同一个键出现多次时按顺序覆盖，最后一个生效
+    int64_t now = currentTimeMs();
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        for (size_t i : groups[s]) {
+            store_.touch(store_.shards_[s].put(keys_and_values[i], keys_and_values[i + 1])->second, now);
+        }
+    }
+}
+
+int KVStore::Batch::multiDel(const std::vector<std::string>& keys) {
+    int deleted = 0;
+    auto groups = store_.groupKeysByShard(keys, 1);
+    auto locks = store_.lockShards<std::unique_lock<std::shared_mutex>>(groups);
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        for (size_t i : groups[s]) {
+            deleted += store_.shards_[s].erase(keys[i]) ? 1 : 0;
+        }
+    }
+    return deleted;
+}
+
+void KVStore::apply(const std::function<void(Batch&)>& fn) {
+    Batch batch(*this);
+    fn(batch);
+}
+
+void KVStore::setMemoryLimit(size_t max_bytes, EvictionPolicy policy) {
+    max_memory_ = max_bytes;
+    policy_ = policy;
+}
+
+size_t KVStore::usedMemory() const {
+    size_t used = 0;
+    for (const auto& shard : shards_) {
+        used += shard.used_bytes.load(std::memory_order_relaxed);
+    }
+    return used;
+}
+
+std::vector<std::string> KVStore::evictionCandidates(size_t bytes_to_free, size_t max_keys) {
+    std::vector<std::string> victims;
+    std::set<std::string> chosen;
+    std::mt19937_64& engine = randomEngine();
+    int64_t now = currentTimeMs();
+    size_t freed = 0;
+    int misses = 0;  // 连续没有采到可选键的轮数
+
+    while (freed < bytes_to_free && victims.size() < max_keys && misses < EVICTION_SAMPLES) {
+        // 采样若干个键，选出淘汰优先级最高的一个
+        std::string best_key;
+        uint64_t best_score = 0;
+        size_t best_bytes = 0;
+        bool found = false;
+        for (int sample = 0; sample < EVICTION_SAMPLES; ++sample) {
+            Shard& shard = shards_[engine() % KV_SHARD_COUNT];
+            std::shared_lock<std::shared_mutex> lock(shard.mtx);
+            if (shard.store.empty()) {
+                continue;
+            }
+            // 从随机的桶开始找非空的桶，装载因子不低时期望只看几个桶；找不到时取第一个元素
+            // 新节点插在桶的开头，在桶内也随机取一个，避免偏向新写入的键
+            size_t buckets = shard.store.bucket_count();
+            size_t bucket = engine() % buckets;
+            const Store::value_type* entry = &*shard.store.begin();
+            for (size_t probe = 0; probe < 16; ++probe, bucket = (bucket + 1) % buckets) {
+                size_t size = shard.store.bucket_size(bucket);
+                if (size > 0) {
+                    auto it = shard.store.begin(bucket);
+                    std::advance(it, engine() % size);
+                    entry = &*it;
+                    break;
+                }
+            }
+            if (chosen.count(entry->first)) {
+                continue;
+            }
+            uint64_t score = evictionScore(shard, *entry, now);
+            if (!found || score > best_score) {
+                best_key = entry->first;
+                best_score = score;
+                best_bytes = Shard::entryBytes(entry->first, entry->second) +
+                             (shard.expires.count(entry->first) ? EXPIRY_BYTES : 0);
+                found = true;
+            }
+        }
+        if (!found) {
+            // 采样都落在空分片或已选中的键上，键很少时连续几轮如此即结束
+            ++misses;
+            continue;
+        }
+        misses = 0;
+        chosen.insert(best_key);
+        victims.push_back(std::move(best_key));
+        freed += best_bytes;
+    }
+    return victims;
 }
 
 void KVStore::clear() {
-    std::lock_guard<std::mutex> lock(mtx_);
-    store_.clear();
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        shard.expires.clear();
+        shard.index.clear();
+        shard.store.clear();
+        shard.used_bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+// 快照格式: [键值对数量(8)]{[键长度(4)][键][值长度(4)][值]}...
+//          [过期时间数量(8)]{[键长度(4)][键][过期时间(8)]}...（旧版本快照没有过期时间部分）
+std::string KVStore::snapshot() {
+    // 按固定顺序锁住所有分片，得到一致的视图
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(KV_SHARD_COUNT);
+    size_t total_size = 2 * sizeof(uint64_t);
+    uint64_t count = 0;
+    uint64_t expire_count = 0;
+    for (auto& shard : shards_) {
+        locks.emplace_back(shard.mtx);
+        count += shard.store.size();
+        for (const auto& kv : shard.store) {
+            total_size += 2 * sizeof(uint32_t) + kv.first.size() + kv.second.view().size();
+        }
+        expire_count += shard.expires.size();
+        for (const auto& entry : shard.expires) {
+            total_size += sizeof(uint32_t) + entry.first.size() + sizeof(int64_t);
+        }
+    }
+
+    std::string result;
+    result.resize(total_size);
+    char* ptr = &result[0];
+    std::memcpy(ptr, &count, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+    for (const auto& shard : shards_) {
+        for (const auto& kv : shard.store) {
+            for (std::string_view part : {std::string_view(kv.first), kv.second.view()}) {
+                uint32_t len = static_cast<uint32_t>(part.size());
+                std::memcpy(ptr, &len, sizeof(uint32_t));
+                ptr += sizeof(uint32_t);
+                std::memcpy(ptr, part.data(), part.size());
+                ptr += part.size();
+            }
+        }
+    }
+    std::memcpy(ptr, &expire_count, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+    for (const auto& shard : shards_) {
+        for (const auto& entry : shard.expires) {
+            uint32_t len = static_cast<uint32_t>(entry.first.size());
+            std::memcpy(ptr, &len, sizeof(uint32_t));
+            ptr += sizeof(uint32_t);
+            std::memcpy(ptr, entry.first.data(), entry.first.size());
+            ptr += entry.first.size();
+            std::memcpy(ptr, &entry.second, sizeof(int64_t));
+            ptr += sizeof(int64_t);
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> KVStore::scan(const std::string& after, const std::string& prefix, size_t count) {
+    std::vector<std::string> keys;
+    if (count == 0) {
+        return keys;
+    }
+    // 每个分片取出本页可能用到的至多count个键，只在这期间持有该分片的读锁
+    int64_t now = currentTimeMs();
+    for (auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        auto it = after.empty() || after < prefix ? shard.index.lower_bound(prefix) : shard.index.upper_bound(after);
+        for (size_t taken = 0; it != shard.index.end() && taken < count; ++it) {
+            if (it->compare(0, prefix.size(), prefix) != 0) {
+                break;  // 有序索引中已越过前缀范围
+            }
+            if (shard.expired(*it, now)) {
+                continue;  // 已过期的键不计入本页
+            }
+            keys.emplace_back(*it);
+            ++taken;
+        }
+    }
+    // 合并各分片的结果，保留最小的count个
+    std::sort(keys.begin(), keys.end());
+    if (keys.size() > count) {
+        keys.resize(count);
+    }
+    return keys;
+}
+
+bool KVStore::restore(const std::string& data) {
+    return restore(data.data(), data.size());
+}
+
+bool KVStore::restore(const char* data, size_t size) {
+    std::array<Store, KV_SHARD_COUNT> restored;
+    const char* ptr = data;
+    const char* end = ptr + size;
+    uint64_t count = 0;
+    if (size < sizeof(uint64_t)) {
+        return false;
+    }
+    std::memcpy(&count, ptr, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+
+    for (uint64_t i = 0; i < count; ++i) {
+        std::string_view parts[2];
+        for (auto& part : parts) {
+            uint32_t len = 0;
+            if (end - ptr < static_cast<ptrdiff_t>(sizeof(uint32_t))) {
+                return false;
+            }
+            std::memcpy(&len, ptr, sizeof(uint32_t));
+            ptr += sizeof(uint32_t);
+            if (end - ptr < static_cast<ptrdiff_t>(len)) {
+                return false;
+            }
+            part = std::string_view(ptr, len);
+            ptr += len;
+        }
+        std::string key(parts[0]);
+        size_t s = shardIndex(key);
+        restored[s].try_emplace(std::move(key), parts[1]);
+    }
+
+    // 加锁前建好有序索引并统计内存；swap只交换节点所有权，索引中的视图仍然有效
+    std::array<std::set<std::string_view>, KV_SHARD_COUNT> indexes;
+    std::array<size_t, KV_SHARD_COUNT> used_bytes{};
+    int64_t now = currentTimeMs();
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        for (const auto& kv : restored[s]) {
+            indexes[s].insert(kv.first);
+            used_bytes[s] += Shard::entryBytes(kv.first, kv.second);
+            touch(kv.second, now);
+        }
+    }
+
+    // 过期时间部分，旧版本快照到此结束
+    std::array<std::unordered_map<std::string_view, int64_t>, KV_SHARD_COUNT> expires;
+    if (ptr != end) {
+        uint64_t expire_count = 0;
+        if (end - ptr < static_cast<ptrdiff_t>(sizeof(uint64_t))) {
+            return false;
+        }
+        std::memcpy(&expire_count, ptr, sizeof(uint64_t));
+        ptr += sizeof(uint64_t);
+        for (uint64_t i = 0; i < expire_count; ++i) {
+            uint32_t len = 0;
+            int64_t expire_at = 0;
+            if (end - ptr < static_cast<ptrdiff_t>(sizeof(uint32_t))) {
+                return false;
+            }
+            std::memcpy(&len, ptr, sizeof(uint32_t));
+            ptr += sizeof(uint32_t);
+            if (end - ptr < static_cast<ptrdiff_t>(len + sizeof(int64_t))) {
+                return false;
+            }
+            std::string key(ptr, len);
+            ptr += len;
+            std::memcpy(&expire_at, ptr, sizeof(int64_t));
+            ptr += sizeof(int64_t);
+            size_t s = shardIndex(key);
+            auto it = restored[s].find(key);
+            if (it == restored[s].end()) {
+                return false;
+            }
+            if (expires[s].insert_or_assign(it->first, expire_at).second) {
+                used_bytes[s] += EXPIRY_BYTES;
+            }
+        }
+    }
+
+    // 按固定顺序锁住所有分片后整体替换，读者不会看到新旧混合的状态
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    locks.reserve(KV_SHARD_COUNT);
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        locks.emplace_back(shards_[s].mtx);
+    }
+    for (size_t s = 0; s < KV_SHARD_COUNT; ++s) {
+        shards_[s].store.swap(restored[s]);
+        shards_[s].index.swap(indexes[s]);
+        shards_[s].expires.swap(expires[s]);
+        shards_[s].used_bytes.store(used_bytes[s], std::memory_order_relaxed);
+    }
+    return true;
 }
 
 } // namespace raft 
\ No newline at end of file
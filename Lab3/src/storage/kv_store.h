@@ -1,18 +1,82 @@
 #ifndef KV_STORE_H
 #define KV_STORE_H
 
+#include "../include/constants.h"
 #include <string>
 #include <unordered_map>
+#include <set>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <array>
 #include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <atomic>
+#include <cstdint>
 
 namespace raft {
 
+// 达到内存上限时的淘汰策略
+enum class EvictionPolicy : uint8_t {
+    NOEVICTION,   // 不淘汰，拒绝会增加内存的写入
+    ALLKEYS_LRU,  // 近似LRU：采样若干个键，淘汰最久未访问的
+    ALLKEYS_LFU,  // 近似LFU：采样若干个键，淘汰访问频率最低的
+};
+
 // KV存储类，作为状态机
+// 按键的哈希分成KV_SHARD_COUNT个分片，每个分片一把读写锁，
+// 客户端读只加读锁，不与日志应用线程对其他分片的写竞争；
+// 每个分片另有一个键的有序索引，支持按前缀分页遍历；
+// 设置了过期时间的键记录绝对过期时间，客户端读取时已过期的键视为不存在，删除由leader写入日志；
+// 按分配器的实际占用统计内存，超过上限时由leader采样选出要淘汰的键写入日志，各副本按日志删除
 class KVStore {
 public:
     KVStore() = default;
     ~KVStore() = default;
 
+    // 批量操作视图，只在apply的回调内有效
+    // 每次操作只锁住键所在的分片；调用者需保证同一时间只有一个写者（日志应用线程）
+    class Batch {
+    public:
+        explicit Batch(KVStore& store) : store_(store) {}
+
+        // 获取键的值，键不存在或已过期时返回false
+        bool get(const std::string& key, std::string& value) const;
+
+        // 设置键值，清除原有的过期时间
+        void set(const std::string& key, const std::string& value);
+
+        // 设置键值和绝对过期时间(ms)
+        void set(const std::string& key, const std::string& value, int64_t expire_at);
+
+        // 设置绝对过期时间(ms)，过期时间不晚于now时直接删除键
+        // @return 键在now时是否存在
+        bool expire(const std::string& key, int64_t expire_at, int64_t now);
+
+        // 清除过期时间
+        // @return 键在now时存在且原先设置了过期时间
+        bool persist(const std::string& key, int64_t now);
+
+        // 键在now时已过期则删除，返回是否删除
+        bool removeExpired(const std::string& key, int64_t now);
+
+        // 删除键，返回键是否存在
+        bool del(const std::string& key);
+
+        // 批量设置，参数为键值交替排列；同时锁住涉及的分片，读者看不到只写了一部分的状态
+        void multiSet(const std::vector<std::string>& keys_and_values);
+
+        // 批量删除，返回实际删除的键数；同时锁住涉及的分片
+        int multiDel(const std::vector<std::string>& keys);
+
+    private:
+        KVStore& store_;
+    };
+
+    // 执行一组操作
+    void apply(const std::function<void(Batch&)>& fn);
+
     // 获取键的值
     std::string get(const std::string& key);
 
@@ -22,17 +86,144 @@ public:
     // 删除键
     void del(const std::string& key);
 
+    // 批量获取，键不存在时对应位置为空字符串；同时持有涉及分片的读锁，结果是同一时刻的视图
+    std::vector<std::string> multiGet(const std::vector<std::string>& keys);
+
+    // 统计存在的键数，重复的键重复计数
+    int countExisting(const std::vector<std::string>& keys);
+
+    // 批量设置；每个分片只加一次锁
+    void multiSet(const std::vector<std::pair<std::string, std::string>>& kvs);
+
+    // 批量删除，返回实际删除的键数；每个分片只加一次锁
+    int multiDel(const std::vector<std::string>& keys);
+
+    // 键的剩余生存时间(ms)，键不存在或已过期时返回-2，没有过期时间时返回-1
+    int64_t ttlMs(const std::string& key);
+
+    // 键的绝对过期时间(ms)，键不存在或没有过期时间时返回-1；不检查是否已过期
+    int64_t expireAt(const std::string& key);
+
+    // 遍历所有设置了过期时间的键，用于重建过期时间轮
+    void forEachExpiry(const std::function<void(const std::string& key, int64_t expire_at)>& fn);
+
+    // 按字典序返回大于after且以prefix开头的至多count个键，after为空时从头开始，用于SCAN/KEYS分页
+    // 复杂度O(分片数 * (log n + count))；每个分片只在取本页时短暂持有读锁，翻页之间不持锁
+    std::vector<std::string> scan(const std::string& after, const std::string& prefix, size_t count);
+
+    // 设置内存上限（字节，0表示不限制）和淘汰策略，在启动前调用
+    void setMemoryLimit(size_t max_bytes, EvictionPolicy policy);
+
+    // 内存上限，0表示不限制
+    size_t maxMemory() const { return max_memory_; }
+
+    // 淘汰策略
+    EvictionPolicy evictionPolicy() const { return policy_; }
+
+    // 当前键值、索引和过期时间占用的内存（字节），不加锁
+    size_t usedMemory() const;
+
+    // 按淘汰策略采样选出要淘汰的键，直到估计释放的内存达到bytes_to_free或选出max_keys个键
+    // 每选一个键采样EVICTION_SAMPLES个键，已过期的键优先；不修改存储，由调用者写入日志后删除
+    std::vector<std::string> evictionCandidates(size_t bytes_to_free, size_t max_keys);
+
     // 清空所有存储
     void clear();
 
+    // 序列化全部键值对，用于生成快照
+    std::string snapshot();
+
+    // 用快照数据替换当前全部内容
+    // @return 数据格式是否正确
+    bool restore(const std::string& data);
+    bool restore(const char* data, size_t size);
+
 private:
-    // 存储的键值对
-    std::unordered_map<std::string, std::string> store_;
-    
-    // 保护存储操作的互斥锁
-    std::mutex mtx_;
+    // 存储中的值：不超过INLINE_SIZE字节的值直接放在对象内，更长的值单独分配恰好大小的内存，
+    // 不像std::string那样为增长保留余量；另有一个访问信息字，供LRU/LFU淘汰使用
+    class Value {
+    public:
+        static constexpr size_t INLINE_SIZE = 16;
+
+        explicit Value(std::string_view data) { store(data); }
+        ~Value() { release(); }
+        Value(const Value&) = delete;
+        Value& operator=(const Value&) = delete;
+
+        // 替换值的内容
+        void assign(std::string_view data);
+
+        std::string_view view() const { return std::string_view(size_ <= INLINE_SIZE ? inline_ : heap_, size_); }
+
+        // 单独分配的内存按分配器实际占用计算的字节数，内联时为0
+        size_t heapBytes() const;
+
+        // LRU时为最近访问的时钟，LFU时为[衰减时间(16位)][对数计数(8位)]；读者在读锁下更新，不要求精确
+        mutable std::atomic<uint32_t> access{0};
+
+    private:
+        void store(std::string_view data);
+        void release();
+
+        uint32_t size_ = 0;
+        union {
+            char inline_[INLINE_SIZE];
+            char* heap_;
+        };
+    };
+
+    using Store = std::unordered_map<std::string, Value>;
+
+    // 一个分片：独立加锁的哈希表
+    struct Shard {
+        Store store;
+        std::set<std::string_view> index;  // store中键的有序索引，视图指向store节点中的键（rehash不移动节点）
+        std::unordered_map<std::string_view, int64_t> expires;  // 设置了过期时间的键的绝对过期时间(ms)，视图同上
+        std::atomic<size_t> used_bytes{0}; // 本分片占用的内存，持有写锁时更新，可不加锁读取
+        mutable std::shared_mutex mtx;
+
+        // 设置键值并维护有序索引，清除原有的过期时间，返回键所在的位置，调用者需持有写锁
+        Store::iterator put(const std::string& key, std::string_view value);
+        // 查找在now时未过期的键，返回值的指针，不存在或已过期时返回nullptr，调用者需持有锁
+        const Value* find(const std::string& key, int64_t now) const;
+        // 键在now时是否已过期，调用者需持有锁
+        bool expired(std::string_view key, int64_t now) const;
+        // 设置键的过期时间，键必须在store中，调用者需持有写锁
+        void setExpiry(std::string_view key, int64_t expire_at);
+        // 清除键的过期时间，返回原先是否设置了过期时间，调用者需持有写锁
+        bool clearExpiry(std::string_view key);
+        // 删除键并维护有序索引，返回键是否存在，调用者需持有写锁
+        bool erase(const std::string& key);
+        // 一个键值对占用的内存：哈希表节点、键和值单独分配的内存、有序索引节点
+        static size_t entryBytes(const std::string& key, const Value& value);
+    };
+
+    // 记录一次访问，用于LRU/LFU淘汰
+    void touch(const Value& value, int64_t now) const;
+
+    // 淘汰优先级，越大越先淘汰
+    uint64_t evictionScore(const Shard& shard, const Store::value_type& entry, int64_t now) const;
+
+    // 键所在的分片
+    size_t shardIndex(const std::string& key) const;
+    Shard& shardFor(const std::string& key);
+
+    // 按分片对下标分组，用于批量操作
+    template <typename T, typename KeyOf>
+    std::array<std::vector<size_t>, KV_SHARD_COUNT> groupByShard(const std::vector<T>& items, KeyOf key_of) const;
+
+    // 按分片对键的下标分组，键在args中每隔stride个出现一次
+    std::array<std::vector<size_t>, KV_SHARD_COUNT> groupKeysByShard(const std::vector<std::string>& args, size_t stride) const;
+
+    // 按分片顺序锁住分组中涉及的所有分片
+    template <typename Lock>
+    std::vector<Lock> lockShards(const std::array<std::vector<size_t>, KV_SHARD_COUNT>& groups);
+
+    std::array<Shard, KV_SHARD_COUNT> shards_;
+    size_t max_memory_ = 0;                            // 内存上限，0表示不限制
+    EvictionPolicy policy_ = EvictionPolicy::NOEVICTION; // 淘汰策略
 };
 
 } // namespace raft
 
-#endif // KV_STORE_H 
\ No newline at end of file
+#endif // KV_STORE_H
@@ -8,7 +8,7 @@
 namespace raft {
 
 InMemoryLogStore::InMemoryLogStore(const std::string& filename) 
-    : file_name_(filename), committed_idx_(0) {
+    : file_name_(filename), base_idx_(0), committed_idx_(0), hard_term_(0), hard_voted_for_(0) {
     // 初始化日志，插入一个空白条目作为索引0
     entries_.push_back("");
     terms_.push_back(0);
@@ -19,54 +19,56 @@ InMemoryLogStore::~InMemoryLogStore() {
     write_to_file();
 }
 
-void InMemoryLogStore::append(const std::string& entry, int term) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    entries_.push_back(entry);
-    terms_.push_back(term);
-    write_to_file();
+void InMemoryLogStore::append(std::string_view entry, int term) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        entries_.emplace_back(entry);
+        terms_.push_back(term);
+        write_to_file();
+    }
+    // 写文件后即视为已持久化
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    if (durable_callback_) {
+        durable_callback_(latest_index());
+    }
 }
 
 int InMemoryLogStore::latest_index() const {
     std::lock_guard<std::mutex> lock(mtx_);
-    return static_cast<int>(entries_.size()) - 1;
+    return base_idx_ + static_cast<int>(entries_.size()) - 1;
 }
 
 int InMemoryLogStore::latest_term() const {
     std::lock_guard<std::mutex> lock(mtx_);
-    if (entries_.size() <= 1) {
-        return 0;
-    }
+    // 日志为空时terms_[0]为快照的任期（没有快照时为0）
     return terms_.back();
 }
 
 std::string InMemoryLogStore::entry_at(int index) const {
     std::lock_guard<std::mutex> lock(mtx_);
-    if (index <= 0 || index >= static_cast<int>(entries_.size())) {
+    if (index <= base_idx_ || index - base_idx_ >= static_cast<int>(entries_.size())) {
         return "";
     }
-    return entries_[index];
+    return entries_[index - base_idx_];
 }
 
 int InMemoryLogStore::term_at(int index) const {
     std::lock_guard<std::mutex> lock(mtx_);
-    if (index < 0 || index >= static_cast<int>(terms_.size())) {
+    if (index < base_idx_ || index - base_idx_ >= static_cast<int>(terms_.size())) {
         return 0;
     }
-    return terms_[index];
+    return terms_[index - base_idx_];
 }
 
 void InMemoryLogStore::erase(int start, int end) {
     std::lock_guard<std::mutex> lock(mtx_);
-    if (start <= 0 || start > end || end >= static_cast<int>(entries_.size())) {
+    if (start <= base_idx_ || start > end || end - base_idx_ >= static_cast<int>(entries_.size())) {
         return;
     }
     
-    // 确保end不超过数组边界
-    end = std::min(end, static_cast<int>(entries_.size()) - 1);
-    
     // 删除从start到end的日志条目
-    entries_.erase(entries_.begin() + start, entries_.begin() + end + 1);
-    terms_.erase(terms_.begin() + start, terms_.begin() + end + 1);
+    entries_.erase(entries_.begin() + (start - base_idx_), entries_.begin() + (end - base_idx_) + 1);
+    terms_.erase(terms_.begin() + (start - base_idx_), terms_.begin() + (end - base_idx_) + 1);
     
     // 删除对应的复制计数
     for (int i = start; i <= end; ++i) {
@@ -81,7 +83,7 @@ void InMemoryLogStore::erase(int start, int end) {
 
 void InMemoryLogStore::commit(int index) {
     std::lock_guard<std::mutex> lock(mtx_);
-    if (index > committed_idx_ && index < static_cast<int>(entries_.size())) {
+    if (index > committed_idx_ && index - base_idx_ < static_cast<int>(entries_.size())) {
         committed_idx_ = index;
     }
 }
@@ -94,7 +96,7 @@ int InMemoryLogStore::committed_index() const {
 void InMemoryLogStore::add_num(int index, int node_id) {
     std::lock_guard<std::mutex> lock(mtx_);
     // 确保索引有效
-    if (index < 0 || index >= static_cast<int>(entries_.size())) {
+    if (index <= base_idx_ || index - base_idx_ >= static_cast<int>(entries_.size())) {
         return;
     }
     
@@ -114,6 +116,60 @@ int InMemoryLogStore::get_num(int index) const {
     return static_cast<int>(it->second.size());
 }
 
+int InMemoryLogStore::durable_index() const {
+    // 每次修改都会整体重写文件，视为全部已持久化
+    return latest_index();
+}
+
+bool InMemoryLogStore::wait_durable(int index) {
+    return index <= latest_index();
+}
+
+void InMemoryLogStore::set_durable_callback(DurableCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    durable_callback_ = callback;
+}
+
+void InMemoryLogStore::compact(int index, int term) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (index <= base_idx_) {
+        return;
+    }
+    int offset = index - base_idx_;
+    if (offset < static_cast<int>(entries_.size()) && terms_[offset] == term) {
+        // 只丢弃被快照覆盖的前缀
+        entries_.erase(entries_.begin(), entries_.begin() + offset);
+        terms_.erase(terms_.begin(), terms_.begin() + offset);
+        entries_[0].clear();
+    } else {
+        // 快照比本地日志新，丢弃整个日志
+        entries_.assign(1, "");
+        terms_.assign(1, term);
+    }
+    base_idx_ = index;
+    num_.erase(num_.begin(), num_.upper_bound(index));
+    committed_idx_ = std::max(committed_idx_, index);
+    write_to_file();
+}
+
+int InMemoryLogStore::snapshot_index() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return base_idx_;
+}
+
+void InMemoryLogStore::save_hard_state(int term, int voted_for) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    hard_term_ = term;
+    hard_voted_for_ = voted_for;
+}
+
+void InMemoryLogStore::load_hard_state(int& term, int& voted_for, int& commit) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    term = hard_term_;
+    voted_for = hard_voted_for_;
+    commit = committed_idx_;
+}
+
 void InMemoryLogStore::write_to_file() const {
     // 将日志内容写入文件
     // 延时2秒,模拟写入延迟
@@ -127,7 +183,7 @@ void InMemoryLogStore::write_to_file() const {
     
     // 写入日志条目和对应的任期
     for (size_t i = 1; i < entries_.size(); ++i) {
-        outfile << "index: " << i << "\tterm: " << terms_[i]  << std::endl;
+        outfile << "index: " << base_idx_ + static_cast<int>(i) << "\tterm: " << terms_[i]  << std::endl;
         outfile << "entry: " << entries_[i] << std::endl;
         outfile << "-------------------------------------" << std::endl;
     }
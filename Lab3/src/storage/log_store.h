@@ -2,20 +2,25 @@
 #define LOG_STORE_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <mutex>
 #include <map>
 #include <fstream>
+#include <functional>
 
 namespace raft {
 
 // 日志存储接口
 class LogStore {
 public:
+    // 持久化回调：durable_index推进后调用，参数为新的durable_index
+    using DurableCallback = std::function<void(int durable_index)>;
+
     virtual ~LogStore() = default;
 
     // 添加日志条目
-    virtual void append(const std::string& entry, int term) = 0;
+    virtual void append(std::string_view entry, int term) = 0;
     
     // 获取最新日志索引
     virtual int latest_index() const = 0;
@@ -43,6 +48,29 @@ public:
     
     // 获取某日志条目的复制计数
     virtual int get_num(int index) const = 0;
+
+    // 获取已持久化到磁盘的最大索引
+    virtual int durable_index() const = 0;
+
+    // 阻塞等待直到index及之前的日志全部持久化
+    // @return 是否已持久化（日志被截断或存储关闭时返回false）
+    virtual bool wait_durable(int index) = 0;
+
+    // 设置持久化回调（传入空函数取消），返回后不会再有旧回调在执行
+    virtual void set_durable_callback(DurableCallback callback) = 0;
+
+    // 快照覆盖到index（任期term）后压缩日志：
+    // 若本地index处的任期与快照一致，只丢弃index及之前的条目；否则丢弃整个日志
+    virtual void compact(int index, int term) = 0;
+
+    // 获取已压缩进快照的最后一条日志索引（没有快照时为0）
+    virtual int snapshot_index() const = 0;
+
+    // 持久化当前任期和投票对象（返回前已落盘）
+    virtual void save_hard_state(int term, int voted_for) = 0;
+
+    // 读取持久化的任期、投票对象和提交索引提示
+    virtual void load_hard_state(int& term, int& voted_for, int& commit) const = 0;
 };
 
 // 内存实现的日志存储
@@ -51,7 +79,7 @@ public:
     InMemoryLogStore(const std::string& filename);
     ~InMemoryLogStore() override;
     
-    void append(const std::string& entry, int term) override;
+    void append(std::string_view entry, int term) override;
     int latest_index() const override;
     int latest_term() const override;
     std::string entry_at(int index) const override;
@@ -61,16 +89,28 @@ public:
     int committed_index() const override;
     void add_num(int index, int node_id) override;
     int get_num(int index) const override;
+    int durable_index() const override;
+    bool wait_durable(int index) override;
+    void set_durable_callback(DurableCallback callback) override;
+    void compact(int index, int term) override;
+    int snapshot_index() const override;
+    void save_hard_state(int term, int voted_for) override;
+    void load_hard_state(int& term, int& voted_for, int& commit) const override;
     
 private:
     std::string file_name_;                  // 日志文件名
-    std::vector<std::string> entries_;       // 日志条目内容
+    int base_idx_;                           // 已压缩进快照的最后一条日志索引
+    std::vector<std::string> entries_;       // 日志条目内容，entries_[0]对应base_idx_
     std::vector<int> terms_;                 // 日志条目的任期
     std::map<int, std::vector<int>> num_;    // 每个日志条目被复制到的节点ID列表
     
     int committed_idx_;                      // 已提交的最大索引
+    int hard_term_;                          // 当前任期（仅保存在内存）
+    int hard_voted_for_;                     // 投票对象（仅保存在内存）
     
     mutable std::mutex mtx_;                 // 保护日志操作的互斥锁
+    DurableCallback durable_callback_;       // 持久化回调
+    std::mutex callback_mutex_;              // 保护持久化回调
     
     // 将日志内容写入文件
     void write_to_file() const;
@@ -0,0 +1,622 @@
+#include "segmented_log_store.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <chrono>
+
+#include "../utils/crc32.h"
+
+namespace raft {
+
+namespace {
+
+// 递归创建目录
+bool makeDirs(const std::string& path) {
+    if (path.empty()) {
+        return true;
+    }
+    size_t pos = 0;
+    while (pos != std::string::npos) {
+        pos = path.find('/', pos + 1);
+        std::string sub = path.substr(0, pos);
+        if (::mkdir(sub.c_str(), 0755) == -1 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 写入全部数据
+bool writeAll(int fd, const char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+} // namespace
+
+SegmentedLogStore::SegmentedLogStore(const std::string& dir, size_t segment_size,
+                                     int group_commit_max_batch, int group_commit_max_delay_us)
+    : dir_(dir),
+      segment_size_(segment_size),
+      max_batch_(group_commit_max_batch),
+      max_delay_us_(group_commit_max_delay_us),
+      base_idx_(0),
+      committed_idx_(0),
+      durable_idx_(0),
+      pending_count_(0),
+      dir_dirty_(false),
+      meta_fd_(-1),
+      hard_term_(0),
+      hard_voted_for_(0),
+      hard_commit_(0),
+      running_(false) {
+    if (!makeDirs(dir_)) {
+        throw std::runtime_error("无法创建日志目录: " + dir_ + ": " + strerror(errno));
+    }
+
+    // 读取持久化的任期、投票和提交索引
+    loadMeta();
+
+    // 初始化日志，插入一个空白条目作为索引0（压缩后代表快照的最后一条）
+    entries_.push_back("");
+    terms_.push_back(0);
+    offsets_.push_back(0);
+
+    // 从已有段文件恢复日志
+    recover();
+    durable_idx_ = lastIndexLocked();
+
+    // 启动组提交刷盘线程
+    running_ = true;
+    flush_thread_ = std::thread(&SegmentedLogStore::flushLoop, this);
+}
+
+SegmentedLogStore::~SegmentedLogStore() {
+    // 停止刷盘线程，退出前会把剩余记录刷盘
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = false;
+    }
+    flush_cv_.notify_all();
+    durable_cv_.notify_all();
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+
+    for (auto& segment : segments_) {
+        if (segment.fd != -1) {
+            ::close(segment.fd);
+        }
+    }
+    if (meta_fd_ != -1) {
+        ::close(meta_fd_);
+    }
+}
+
+void SegmentedLogStore::recover() {
+    // 按文件名（段内第一条日志索引）排序
+    std::vector<int> first_indexes;
+    if (DIR* d = ::opendir(dir_.c_str())) {
+        while (struct dirent* ent = ::readdir(d)) {
+            std::string name = ent->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".seg") == 0) {
+                first_indexes.push_back(std::atoi(name.c_str()));
+            }
+        }
+        ::closedir(d);
+    }
+    std::sort(first_indexes.begin(), first_indexes.end());
+
+    bool valid = true;
+    for (int first_index : first_indexes) {
+        std::string path = segmentPath(first_index);
+        int expected = segments_.empty() ? first_index : lastIndexLocked() + 1;
+        if (!valid || first_index != expected) {
+            // 前面的段尾部损坏或段之间不连续，之后的段都不可信
+            std::cerr << "丢弃不连续的日志段: " << path << std::endl;
+            ::unlink(path.c_str());
+            valid = false;
+            continue;
+        }
+        if (segments_.empty()) {
+            base_idx_ = first_index - 1;
+        }
+
+        Segment segment;
+        segment.first_index = first_index;
+        segment.path = path;
+        segment.size = 0;
+        segment.fd = ::open(path.c_str(), O_RDWR);
+        struct stat st;
+        if (segment.fd == -1 || ::fstat(segment.fd, &st) == -1) {
+            throw std::runtime_error("无法打开日志段: " + path + ": " + strerror(errno));
+        }
+
+        // 映射整个段文件，逐条校验记录
+        uint64_t file_size = static_cast<uint64_t>(st.st_size);
+        uint64_t offset = 0;
+        if (file_size > 0) {
+            void* addr = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, segment.fd, 0);
+            if (addr == MAP_FAILED) {
+                throw std::runtime_error("无法映射日志段: " + path + ": " + strerror(errno));
+            }
+            const char* base = static_cast<const char*>(addr);
+            int next_index = expected;
+            while (offset + RECORD_HEADER_SIZE <= file_size) {
+                const char* ptr = base + offset;
+                uint32_t length, crc;
+                int index, term;
+                std::memcpy(&length, ptr, sizeof(uint32_t));
+                std::memcpy(&crc, ptr + sizeof(uint32_t), sizeof(uint32_t));
+                std::memcpy(&index, ptr + 2 * sizeof(uint32_t), sizeof(int));
+                std::memcpy(&term, ptr + 3 * sizeof(uint32_t), sizeof(int));
+                uint64_t record_size = RECORD_HEADER_SIZE + length;
+                if (offset + record_size > file_size || index != next_index ||
+                    crc32(ptr + 2 * sizeof(uint32_t), record_size - 2 * sizeof(uint32_t)) != crc) {
+                    break;
+                }
+                entries_.emplace_back(ptr + RECORD_HEADER_SIZE, length);
+                terms_.push_back(term);
+                offsets_.push_back(offset);
+                offset += record_size;
+                ++next_index;
+            }
+            ::munmap(addr, file_size);
+        }
+
+        if (offset < file_size) {
+            // 尾部记录不完整或校验失败（崩溃时写了一半），截掉
+            std::cerr << "日志段 " << path << " 在偏移 " << offset << " 处损坏，截断" << std::endl;
+            if (::ftruncate(segment.fd, static_cast<off_t>(offset)) == -1) {
+                throw std::runtime_error("截断日志段失败: " + path + ": " + strerror(errno));
+            }
+            valid = false;
+        }
+        segment.size = offset;
+        segments_.push_back(segment);
+    }
+
+    if (segments_.empty()) {
+        if (!openSegment(1)) {
+            throw std::runtime_error("无法创建日志段: " + segmentPath(1));
+        }
+    }
+    if (lastIndexLocked() > 0) {
+        std::cout << "从 " << dir_ << " 恢复日志 [" << base_idx_ + 1 << ", " << lastIndexLocked() << "]" << std::endl;
+    }
+}
+
+void SegmentedLogStore::loadMeta() {
+    std::string path = dir_ + "/raft_meta.dat";
+    meta_fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (meta_fd_ == -1) {
+        throw std::runtime_error("无法打开元数据文件: " + path + ": " + strerror(errno));
+    }
+    int fields[META_FIELDS] = {0};
+    uint32_t crc = 0;
+    if (::pread(meta_fd_, fields, sizeof(fields), 0) == static_cast<ssize_t>(sizeof(fields)) &&
+        ::pread(meta_fd_, &crc, sizeof(crc), sizeof(fields)) == static_cast<ssize_t>(sizeof(crc)) &&
+        crc32(fields, sizeof(fields)) == crc) {
+        hard_term_ = fields[0];
+        hard_voted_for_ = fields[1];
+        hard_commit_ = fields[2];
+    }
+}
+
+void SegmentedLogStore::writeMeta(bool sync) {
+    // 格式: [term(4)][voted_for(4)][commit(4)][crc32(4)]，固定写在文件开头
+    char buf[META_FIELDS * sizeof(int) + sizeof(uint32_t)];
+    int fields[META_FIELDS] = {hard_term_, hard_voted_for_, hard_commit_};
+    uint32_t crc = crc32(fields, sizeof(fields));
+    std::memcpy(buf, fields, sizeof(fields));
+    std::memcpy(buf + sizeof(fields), &crc, sizeof(crc));
+    if (!writeAll(meta_fd_, buf, sizeof(buf), 0)) {
+        std::cerr << "写入元数据失败: " << strerror(errno) << std::endl;
+        return;
+    }
+    if (sync) {
+        ::fdatasync(meta_fd_);
+    }
+}
+
+void SegmentedLogStore::save_hard_state(int term, int voted_for) {
+    std::lock_guard<std::mutex> lock(meta_mutex_);
+    if (term == hard_term_ && voted_for == hard_voted_for_) {
+        return;
+    }
+    hard_term_ = term;
+    hard_voted_for_ = voted_for;
+    writeMeta(true);
+}
+
+void SegmentedLogStore::load_hard_state(int& term, int& voted_for, int& commit) const {
+    std::lock_guard<std::mutex> lock(meta_mutex_);
+    term = hard_term_;
+    voted_for = hard_voted_for_;
+    commit = hard_commit_;
+}
+
+std::string SegmentedLogStore::segmentPath(int first_index) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020d.seg", first_index);
+    return dir_ + "/" + name;
+}
+
+bool SegmentedLogStore::openSegment(int first_index) {
+    Segment segment;
+    segment.first_index = first_index;
+    segment.path = segmentPath(first_index);
+    segment.size = 0;
+    segment.fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (segment.fd == -1) {
+        std::cerr << "无法打开日志段 " << segment.path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    segments_.push_back(segment);
+    dir_dirty_ = true;
+    return true;
+}
+
+void SegmentedLogStore::removeSegment(const Segment& segment) {
+    if (segment.fd != -1) {
+        ::close(segment.fd);
+    }
+    ::unlink(segment.path.c_str());
+}
+
+size_t SegmentedLogStore::segmentFor(int index) const {
+    // 找到最后一个first_index <= index的段
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), index,
+        [](int idx, const Segment& segment) { return idx < segment.first_index; });
+    return it == segments_.begin() ? 0 : static_cast<size_t>(it - segments_.begin() - 1);
+}
+
+void SegmentedLogStore::append(std::string_view entry, int term) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    int index = lastIndexLocked() + 1;
+    size_t record_size = RECORD_HEADER_SIZE + entry.size();
+
+    // 当前段已满时滚动到新段（空段总能容纳至少一条记录）
+    if (segments_.back().size > 0 && segments_.back().size + record_size > segment_size_) {
+        if (!openSegment(index)) {
+            throw std::runtime_error("无法创建日志段: " + segmentPath(index));
+        }
+    }
+    Segment& segment = segments_.back();
+
+    // 与上一条待写记录连续时合并到同一次写入
+    if (pending_.empty() || pending_.back().fd != segment.fd) {
+        pending_.push_back(PendingWrite{segment.fd, segment.size, std::string()});
+    }
+    std::string& buf = pending_.back().data;
+    size_t pos = buf.size();
+    buf.resize(pos + record_size);
+
+    // 编码记录: [长度][crc][index][term][payload]
+    char* ptr = &buf[pos];
+    uint32_t length = static_cast<uint32_t>(entry.size());
+    std::memcpy(ptr, &length, sizeof(uint32_t));
+    std::memcpy(ptr + 2 * sizeof(uint32_t), &index, sizeof(int));
+    std::memcpy(ptr + 3 * sizeof(uint32_t), &term, sizeof(int));
+    std::memcpy(ptr + RECORD_HEADER_SIZE, entry.data(), entry.size());
+    uint32_t crc = crc32(ptr + 2 * sizeof(uint32_t), record_size - 2 * sizeof(uint32_t));
+    std::memcpy(ptr + sizeof(uint32_t), &crc, sizeof(uint32_t));
+
+    entries_.emplace_back(entry);
+    terms_.push_back(term);
+    offsets_.push_back(segment.size);
+    segment.size += record_size;
+
+    // 唤醒刷盘线程
+    if (++pending_count_ == 1 || pending_count_ >= max_batch_) {
+        lock.unlock();
+        flush_cv_.notify_one();
+    }
+}
+
+void SegmentedLogStore::flushLoop() {
+    std::unique_lock<std::mutex> io_lock(io_mutex_, std::defer_lock);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            flush_cv_.wait(lock, [this] { return !running_ || pending_count_ > 0; });
+            if (!running_ && pending_count_ == 0) {
+                break;
+            }
+            // 未满一批时再等待一小段时间，让并发的追加合并到同一次fdatasync
+            if (running_ && pending_count_ < max_batch_ && max_delay_us_ > 0) {
+                flush_cv_.wait_for(lock, std::chrono::microseconds(max_delay_us_),
+                    [this] { return !running_ || pending_count_ >= max_batch_; });
+            }
+        }
+
+        io_lock.lock();
+        std::unique_lock<std::mutex> lock(mtx_);
+        try {
+            flushPending(lock);
+        } catch (const std::exception& e) {
+            // 未写成功的记录已放回待写缓冲区，稍后重试；持久化进度不变，也不通知上层
+            std::cerr << "日志刷盘失败: " << e.what() << std::endl;
+            bool stopping = !running_;
+            lock.unlock();
+            io_lock.unlock();
+            if (stopping) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(GROUP_COMMIT_RETRY_MS));
+            continue;
+        }
+        int durable = durable_idx_;
+        int commit = std::min(committed_idx_, durable_idx_);
+        lock.unlock();
+        io_lock.unlock();
+
+        // 通知上层持久化进度（leader据此把自己计入多数派）
+        {
+            std::lock_guard<std::mutex> callback_lock(callback_mutex_);
+            if (durable_callback_) {
+                durable_callback_(durable);
+            }
+        }
+
+        // 顺带更新提交索引提示（不单独fsync，丢失只会让重启时少重放一些日志）
+        std::lock_guard<std::mutex> meta_lock(meta_mutex_);
+        if (commit > hard_commit_) {
+            hard_commit_ = commit;
+            writeMeta(false);
+        }
+    }
+}
+
+void SegmentedLogStore::flushPending(std::unique_lock<std::mutex>& lock) {
+    if (pending_.empty()) {
+        return;
+    }
+    std::vector<PendingWrite> batch;
+    batch.swap(pending_);
+    int target = lastIndexLocked();
+    int count = pending_count_;
+    bool sync_dir = dir_dirty_;
+    pending_count_ = 0;
+    dir_dirty_ = false;
+    lock.unlock();
+
+    // 写入并同步每个涉及到的段文件（通常只有一个）
+    std::string error;
+    for (size_t i = 0; i < batch.size() && error.empty(); ++i) {
+        const PendingWrite& write = batch[i];
+        if (!writeAll(write.fd, write.data.data(), write.data.size(), write.offset)) {
+            error = std::string("写入日志段失败: ") + strerror(errno);
+        } else if ((i + 1 == batch.size() || batch[i + 1].fd != write.fd) && ::fdatasync(write.fd) == -1) {
+            error = std::string("同步日志段失败: ") + strerror(errno);
+        }
+    }
+    if (error.empty() && sync_dir) {
+        int dir_fd = ::open(dir_.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dir_fd == -1 || ::fsync(dir_fd) == -1) {
+            error = std::string("同步日志目录失败: ") + strerror(errno);
+        }
+        if (dir_fd != -1) {
+            ::close(dir_fd);
+        }
+    }
+
+    lock.lock();
+    if (!error.empty()) {
+        // 整批放回待写缓冲区的最前面，下次按原偏移重写并重新同步（同步失败后脏页可能已被丢弃，必须重写）
+        pending_.insert(pending_.begin(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        pending_count_ += count;
+        dir_dirty_ = dir_dirty_ || sync_dir;
+        throw std::runtime_error(error);
+    }
+    durable_idx_ = std::max(durable_idx_, target);
+    durable_cv_.notify_all();
+}
+
+int SegmentedLogStore::lastIndexLocked() const {
+    return base_idx_ + static_cast<int>(entries_.size()) - 1;
+}
+
+int SegmentedLogStore::latest_index() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return lastIndexLocked();
+}
+
+int SegmentedLogStore::latest_term() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return terms_.back();
+}
+
+std::string SegmentedLogStore::entry_at(int index) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (index <= base_idx_ || index > lastIndexLocked()) {
+        return "";
+    }
+    return entries_[index - base_idx_];
+}
+
+int SegmentedLogStore::term_at(int index) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (index < base_idx_ || index > lastIndexLocked()) {
+        return 0;
+    }
+    return terms_[index - base_idx_];
+}
+
+int SegmentedLogStore::snapshot_index() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return base_idx_;
+}
+
+void SegmentedLogStore::erase(int start, int end) {
+    // 先把待写记录刷盘，保证截断时文件内容与内存一致
+    std::lock_guard<std::mutex> io_lock(io_mutex_);
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (!pending_.empty()) {
+        flushPending(lock);
+    }
+
+    int last = lastIndexLocked();
+    if (start <= base_idx_ || start > end || end > last) {
+        return;
+    }
+    if (end != last) {
+        std::cerr << "SegmentedLogStore只支持截断日志尾部: [" << start << ", " << end << "]" << std::endl;
+        return;
+    }
+
+    // 删除start之后开始的整段文件
+    size_t seg_idx = segmentFor(start);
+    while (segments_.size() > seg_idx + 1) {
+        removeSegment(segments_.back());
+        segments_.pop_back();
+    }
+
+    // 将start所在段截断到该记录的起始偏移
+    Segment& segment = segments_.back();
+    uint64_t offset = offsets_[start - base_idx_];
+    if (segment.first_index == start && segments_.size() > 1) {
+        // 整段都被截断，直接删除
+        removeSegment(segment);
+        segments_.pop_back();
+    } else {
+        if (::ftruncate(segment.fd, static_cast<off_t>(offset)) == -1) {
+            throw std::runtime_error("截断日志段失败: " + segment.path + ": " + strerror(errno));
+        }
+        ::fdatasync(segment.fd);
+        segment.size = offset;
+    }
+
+    entries_.resize(start - base_idx_);
+    terms_.resize(start - base_idx_);
+    offsets_.resize(start - base_idx_);
+
+    // 删除对应的复制计数
+    num_.erase(num_.lower_bound(start), num_.end());
+
+    durable_idx_ = std::min(durable_idx_, start - 1);
+    durable_cv_.notify_all();
+}
+
+void SegmentedLogStore::compact(int index, int term) {
+    std::lock_guard<std::mutex> io_lock(io_mutex_);
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (index < base_idx_) {
+        return;
+    }
+    if (index == base_idx_) {
+        // 恢复时日志恰好从快照之后开始，只需补上快照的任期
+        terms_[0] = term;
+        return;
+    }
+    // 先刷盘，避免待写记录指向即将删除的段文件
+    while (!pending_.empty()) {
+        flushPending(lock);
+    }
+
+    if (index <= lastIndexLocked() && terms_[index - base_idx_] == term) {
+        // 快照覆盖日志前缀：删除所有条目都不晚于index的整段文件，
+        // 部分覆盖的段保留，恢复时跳过快照之前的记录
+        while (segments_.size() > 1 && segments_[1].first_index <= index + 1) {
+            removeSegment(segments_.front());
+            segments_.erase(segments_.begin());
+        }
+        size_t drop = static_cast<size_t>(index - base_idx_);
+        entries_.erase(entries_.begin(), entries_.begin() + drop);
+        terms_.erase(terms_.begin(), terms_.begin() + drop);
+        offsets_.erase(offsets_.begin(), offsets_.begin() + drop);
+        entries_[0].clear();
+        entries_[0].shrink_to_fit();
+    } else {
+        // 快照比本地日志新（或与本地日志冲突）：丢弃整个日志，从快照之后重新开始
+        for (const auto& segment : segments_) {
+            removeSegment(segment);
+        }
+        segments_.clear();
+        entries_.assign(1, "");
+        terms_.assign(1, term);
+        offsets_.assign(1, 0);
+        durable_idx_ = index;
+        if (!openSegment(index + 1)) {
+            throw std::runtime_error("无法创建日志段: " + segmentPath(index + 1));
+        }
+        durable_cv_.notify_all();
+    }
+
+    base_idx_ = index;
+    num_.erase(num_.begin(), num_.upper_bound(index));
+    committed_idx_ = std::max(committed_idx_, index);
+}
+
+void SegmentedLogStore::commit(int index) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (index > committed_idx_ && index <= lastIndexLocked()) {
+        committed_idx_ = index;
+    }
+}
+
+int SegmentedLogStore::committed_index() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return committed_idx_;
+}
+
+void SegmentedLogStore::add_num(int index, int node_id) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (index <= base_idx_ || index > lastIndexLocked()) {
+        return;
+    }
+    auto& nodes = num_[index];
+    if (std::find(nodes.begin(), nodes.end(), node_id) == nodes.end()) {
+        nodes.push_back(node_id);
+    }
+}
+
+int SegmentedLogStore::get_num(int index) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = num_.find(index);
+    if (it == num_.end()) {
+        return 0;
+    }
+    return static_cast<int>(it->second.size());
+}
+
+int SegmentedLogStore::durable_index() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return durable_idx_;
+}
+
+bool SegmentedLogStore::wait_durable(int index) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    durable_cv_.wait(lock, [this, index] {
+        return durable_idx_ >= index || index > lastIndexLocked() || !running_;
+    });
+    return durable_idx_ >= index;
+}
+
+void SegmentedLogStore::set_durable_callback(DurableCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    durable_callback_ = callback;
+}
+
+} // namespace raft
@@ -0,0 +1,151 @@
+#ifndef SEGMENTED_LOG_STORE_H
+#define SEGMENTED_LOG_STORE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+
+#include "log_store.h"
+#include "../include/constants.h"
+
+namespace raft {
+
+/**
+ * 分段二进制日志存储（预写日志）
+ *
+ * 日志条目以记录的形式追加到固定大小的段文件中，每条记录格式为：
+ *   [payload长度(4)][crc32(4)][index(4)][term(4)][payload]
+ * crc32覆盖index、term和payload。段文件写满后滚动到新文件，
+ * 文件名为该段第一条日志的索引。追加只写入新记录，代价与日志总长度无关；
+ * 截断时删除整段文件并将所在段截断到记录起始偏移。
+ *
+ * 写盘采用组提交：append只把记录放入待写缓冲区并立即返回，
+ * 由后台刷盘线程把一段时间内积累的记录合并为一次写入加一次fdatasync，
+ * 然后推进durable_index并调用持久化回调。需要持久化保证的调用者通过wait_durable等待，
+ * 或在回调中处理（follower据此异步确认AppendEntries，处理请求的线程不必阻塞）。
+ *
+ * 内存中仍保留条目内容和任期，供entry_at/term_at直接读取。
+ * 生成快照后通过compact丢弃日志前缀，并删除完全被快照覆盖的段文件。
+ *
+ * 启动时mmap已有的段文件逐条校验crc恢复日志，遇到不完整或损坏的记录即截断。
+ * 任期、投票对象和提交索引提示保存在同目录的raft_meta.dat中。
+ */
+class SegmentedLogStore : public LogStore {
+public:
+    /**
+     * 构造函数
+     * @param dir 段文件所在目录（不存在时自动创建）
+     * @param segment_size 单个段文件的最大字节数
+     * @param group_commit_max_batch 待写条数达到该值时立即刷盘
+     * @param group_commit_max_delay_us 未满一批时刷盘前最多等待的时间(us)
+     */
+    SegmentedLogStore(const std::string& dir,
+                      size_t segment_size = LOG_SEGMENT_SIZE,
+                      int group_commit_max_batch = GROUP_COMMIT_MAX_BATCH,
+                      int group_commit_max_delay_us = GROUP_COMMIT_MAX_DELAY_US);
+    ~SegmentedLogStore() override;
+
+    void append(std::string_view entry, int term) override;
+    int latest_index() const override;
+    int latest_term() const override;
+    std::string entry_at(int index) const override;
+    int term_at(int index) const override;
+    // 只支持截断日志尾部，end必须是最新索引
+    void erase(int start, int end) override;
+    void commit(int index) override;
+    int committed_index() const override;
+    void add_num(int index, int node_id) override;
+    int get_num(int index) const override;
+    int durable_index() const override;
+    bool wait_durable(int index) override;
+    void set_durable_callback(DurableCallback callback) override;
+    void compact(int index, int term) override;
+    int snapshot_index() const override;
+    void save_hard_state(int term, int voted_for) override;
+    void load_hard_state(int& term, int& voted_for, int& commit) const override;
+
+    // 记录头大小
+    static constexpr size_t RECORD_HEADER_SIZE = 4 * sizeof(uint32_t);
+
+private:
+    // 段文件信息
+    struct Segment {
+        int first_index;       // 段内第一条日志的索引
+        int fd;                // 文件描述符
+        uint64_t size;         // 已分配的字节数（包括尚未刷盘的记录）
+        std::string path;      // 文件路径
+    };
+
+    // 一段连续的待写记录，属于同一个段文件
+    struct PendingWrite {
+        int fd;                // 目标段文件
+        uint64_t offset;       // 写入偏移
+        std::string data;      // 编码后的记录
+    };
+
+    std::string dir_;                         // 段文件目录
+    size_t segment_size_;                     // 段大小上限
+    int max_batch_;                           // 组提交批大小
+    int max_delay_us_;                        // 组提交最大等待时间
+
+    int base_idx_;                            // 已压缩进快照的最后一条日志索引
+    std::vector<std::string> entries_;        // 日志条目内容，entries_[0]对应base_idx_
+    std::vector<int> terms_;                  // 日志条目的任期
+    std::vector<uint64_t> offsets_;           // 每条日志在所在段内的偏移
+    std::vector<Segment> segments_;           // 按first_index升序排列的段
+    std::map<int, std::vector<int>> num_;     // 每个日志条目被复制到的节点ID列表
+
+    int committed_idx_;                       // 已提交的最大索引
+    int durable_idx_;                         // 已fdatasync的最大索引
+
+    std::vector<PendingWrite> pending_;       // 待刷盘的记录
+    int pending_count_;                       // 待刷盘的条目数
+    bool dir_dirty_;                          // 是否新建了段文件，需要同步目录
+
+    static constexpr int META_FIELDS = 3;     // 元数据字段数: term, voted_for, commit
+    int meta_fd_;                             // 元数据文件
+    int hard_term_;                           // 持久化的当前任期
+    int hard_voted_for_;                      // 持久化的投票对象
+    int hard_commit_;                         // 持久化的提交索引提示
+    mutable std::mutex meta_mutex_;           // 保护元数据
+
+    mutable std::mutex mtx_;                  // 保护内存状态和待写缓冲区
+    std::mutex io_mutex_;                     // 串行化文件写入/截断，先于mtx_获取
+    std::condition_variable flush_cv_;        // 唤醒刷盘线程
+    std::condition_variable durable_cv_;      // 通知durable_idx_推进
+    DurableCallback durable_callback_;        // 持久化回调，由刷盘线程调用
+    std::mutex callback_mutex_;               // 保护持久化回调
+    std::atomic<bool> running_;               // 刷盘线程是否运行
+    std::thread flush_thread_;                // 刷盘线程
+
+    // 刷盘线程主循环
+    void flushLoop();
+    // 把待写记录写入文件并fdatasync，调用者需持有io_mutex_
+    void flushPending(std::unique_lock<std::mutex>& lock);
+    // 从已有段文件恢复日志
+    void recover();
+    // 读取元数据文件
+    void loadMeta();
+    // 写入元数据文件，调用者需持有meta_mutex_
+    void writeMeta(bool sync);
+    // 最新日志索引，调用者需持有mtx_
+    int lastIndexLocked() const;
+    // 创建以first_index命名的新段
+    bool openSegment(int first_index);
+    // 关闭并删除一个段文件
+    void removeSegment(const Segment& segment);
+    // 查找包含指定索引的段（下标）
+    size_t segmentFor(int index) const;
+    // 构造段文件路径
+    std::string segmentPath(int first_index) const;
+};
+
+} // namespace raft
+
+#endif // SEGMENTED_LOG_STORE_H
@@ -0,0 +1,199 @@
+#include "snapshot_store.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include "../utils/crc32.h"
+
+namespace raft {
+
+namespace {
+
+constexpr uint32_t SNAPSHOT_MAGIC = 0x52534E50;  // "RSNP"
+
+} // namespace
+
+SnapshotStore::SnapshotStore(const std::string& path)
+    : path_(path), last_included_index_(0), last_included_term_(0) {
+}
+
+bool SnapshotStore::save(int index, int term, const std::string& data) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (index <= last_included_index_) {
+        return true;  // 已有更新的快照
+    }
+
+    // 编码文件头
+    std::string header(HEADER_SIZE, '\0');
+    char* ptr = &header[0];
+    uint32_t magic = SNAPSHOT_MAGIC;
+    uint64_t size = data.size();
+    uint32_t crc = crc32(data.data(), data.size());
+    std::memcpy(ptr, &magic, sizeof(uint32_t));
+    ptr += sizeof(uint32_t);
+    std::memcpy(ptr, &index, sizeof(int));
+    ptr += sizeof(int);
+    std::memcpy(ptr, &term, sizeof(int));
+    ptr += sizeof(int);
+    std::memcpy(ptr, &size, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+    std::memcpy(ptr, &crc, sizeof(uint32_t));
+
+    // 写临时文件，fsync后rename覆盖
+    std::string tmp_path = path_ + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        std::cerr << "无法创建快照文件 " << tmp_path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = true;
+    const std::string* parts[] = {&header, &data};
+    for (const std::string* part : parts) {
+        const char* p = part->data();
+        size_t left = part->size();
+        while (ok && left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                ok = false;
+                break;
+            }
+            p += n;
+            left -= n;
+        }
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp_path.c_str(), path_.c_str()) == -1) {
+        std::cerr << "写入快照文件失败 " << path_ << ": " << strerror(errno) << std::endl;
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+
+    // 同步所在目录，rename落盘后调用者才能删除快照覆盖的日志段
+    size_t slash = path_.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path_.substr(0, slash));
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd == -1 || ::fsync(dir_fd) == -1) {
+        std::cerr << "同步快照目录失败 " << dir << ": " << strerror(errno) << std::endl;
+        if (dir_fd != -1) {
+            ::close(dir_fd);
+        }
+        return false;
+    }
+    ::close(dir_fd);
+
+    last_included_index_ = index;
+    last_included_term_ = term;
+    return true;
+}
+
+bool SnapshotStore::read(int& index, int& term, std::string& data) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (last_included_index_ == 0) {
+        return false;
+    }
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    char header[HEADER_SIZE];
+    uint64_t size = 0;
+    uint32_t crc = 0;
+    bool ok = ::pread(fd, header, HEADER_SIZE, 0) == static_cast<ssize_t>(HEADER_SIZE) &&
+              parseHeader(header, index, term, size, crc);
+    if (ok) {
+        data.resize(size);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::pread(fd, &data[done], size - done, static_cast<off_t>(HEADER_SIZE + done));
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+        ok = done == size && crc32(data.data(), data.size()) == crc;
+    }
+    ::close(fd);
+
+    if (!ok) {
+        std::cerr << "快照文件损坏: " << path_ << std::endl;
+    }
+    return ok;
+}
+
+bool SnapshotStore::load(const std::function<bool(const char* data, size_t size)>& restore) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;  // 没有快照
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t file_size = static_cast<size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "无法映射快照文件 " << path_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    // 顺序读取整个文件
+    ::madvise(addr, file_size, MADV_SEQUENTIAL);
+
+    const char* base = static_cast<const char*>(addr);
+    int index = 0;
+    int term = 0;
+    uint64_t size = 0;
+    uint32_t crc = 0;
+    bool ok = parseHeader(base, index, term, size, crc) &&
+              HEADER_SIZE + size <= file_size &&
+              crc32(base + HEADER_SIZE, size) == crc &&
+              restore(base + HEADER_SIZE, size);
+    ::munmap(addr, file_size);
+
+    if (!ok) {
+        std::cerr << "快照文件损坏: " << path_ << std::endl;
+        return false;
+    }
+    last_included_index_ = index;
+    last_included_term_ = term;
+    return true;
+}
+
+bool SnapshotStore::parseHeader(const char* header, int& index, int& term, uint64_t& size, uint32_t& crc) {
+    uint32_t magic = 0;
+    const char* ptr = header;
+    std::memcpy(&magic, ptr, sizeof(uint32_t));
+    ptr += sizeof(uint32_t);
+    std::memcpy(&index, ptr, sizeof(int));
+    ptr += sizeof(int);
+    std::memcpy(&term, ptr, sizeof(int));
+    ptr += sizeof(int);
+    std::memcpy(&size, ptr, sizeof(uint64_t));
+    ptr += sizeof(uint64_t);
+    std::memcpy(&crc, ptr, sizeof(uint32_t));
+    return magic == SNAPSHOT_MAGIC;
+}
+
+int SnapshotStore::last_included_index() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return last_included_index_;
+}
+
+int SnapshotStore::last_included_term() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return last_included_term_;
+}
+
+} // namespace raft
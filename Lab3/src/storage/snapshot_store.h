@@ -0,0 +1,74 @@
+#ifndef SNAPSHOT_STORE_H
+#define SNAPSHOT_STORE_H
+
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include <functional>
+
+namespace raft {
+
+/**
+ * 快照存储
+ *
+ * 保存状态机快照以及它覆盖到的最后一条日志的索引和任期。
+ * 文件格式：[magic(4)][index(4)][term(4)][数据长度(8)][crc32(4)][数据]
+ * 写入时先写临时文件并fsync，再rename覆盖旧快照，保证崩溃后总有一份完整快照。
+ * 启动时通过load映射快照文件直接恢复状态机，不额外复制快照数据。
+ */
+class SnapshotStore {
+public:
+    /**
+     * 构造函数
+     * @param path 快照文件路径
+     */
+    explicit SnapshotStore(const std::string& path);
+    ~SnapshotStore() = default;
+
+    /**
+     * 保存快照
+     * @param index 快照覆盖的最后一条日志索引
+     * @param term 该日志的任期
+     * @param data 状态机序列化后的数据
+     * @return 是否保存成功（成功时快照文件和目录项都已落盘）
+     */
+    bool save(int index, int term, const std::string& data);
+
+    /**
+     * 读取当前快照
+     * @param index 输出快照覆盖的最后一条日志索引
+     * @param term 输出该日志的任期
+     * @param data 输出快照数据
+     * @return 是否存在有效快照
+     */
+    bool read(int& index, int& term, std::string& data) const;
+
+    /**
+     * 启动时加载已有快照：mmap快照文件，校验crc后把数据交给restore恢复状态机
+     * @param restore 恢复回调，参数为快照数据的起始地址和长度
+     * @return 是否加载了有效快照（没有快照文件时返回false）
+     */
+    bool load(const std::function<bool(const char* data, size_t size)>& restore);
+
+    // 获取当前快照覆盖的最后一条日志索引（没有快照时为0）
+    int last_included_index() const;
+
+    // 获取当前快照覆盖的最后一条日志的任期
+    int last_included_term() const;
+
+    // 快照文件头大小
+    static constexpr size_t HEADER_SIZE = 3 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+
+private:
+    // 解析文件头，成功时输出index、term、数据长度和crc
+    static bool parseHeader(const char* header, int& index, int& term, uint64_t& size, uint32_t& crc);
+
+    std::string path_;                   // 快照文件路径
+    int last_included_index_;            // 快照覆盖的最后一条日志索引
+    int last_included_term_;             // 该日志的任期
+    mutable std::mutex mtx_;             // 保护快照文件读写
+};
+
+} // namespace raft
+
+#endif // SNAPSHOT_STORE_H
@@ -0,0 +1,153 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace raft {
+
+/**
+ * 二进制编码器：按小端字节序把字段追加到输出缓冲区末尾
+ * 缓冲区由调用者持有，可以反复clear后复用，避免每条消息重新分配
+ */
+class BufferWriter {
+public:
+    explicit BufferWriter(std::string& out) : out_(out) {}
+
+    void writeU8(uint8_t value) {
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void writeU32(uint32_t value) {
+        char bytes[4] = {
+            static_cast<char>(value), static_cast<char>(value >> 8),
+            static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+        out_.append(bytes, sizeof(bytes));
+    }
+
+    void writeU64(uint64_t value) {
+        writeU32(static_cast<uint32_t>(value));
+        writeU32(static_cast<uint32_t>(value >> 32));
+    }
+
+    void writeI32(int value) { writeU32(static_cast<uint32_t>(value)); }
+
+    void writeBool(bool value) { writeU8(value ? 1 : 0); }
+
+    // 写入原始字节
+    void writeBytes(const char* data, size_t size) { out_.append(data, size); }
+
+    // 写入[长度(4)][内容]
+    void writeString(std::string_view value) {
+        writeU32(static_cast<uint32_t>(value.size()));
+        writeBytes(value.data(), value.size());
+    }
+
+    // 覆盖已写入位置的4字节（用于回填长度）
+    void patchU32(size_t pos, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out_[pos + i] = static_cast<char>(value >> (8 * i));
+        }
+    }
+
+    size_t size() const { return out_.size(); }
+
+    void reserve(size_t size) { out_.reserve(size); }
+
+private:
+    std::string& out_;
+};
+
+/**
+ * 二进制解码器：按小端字节序从一段内存中读取字段，越界时返回false
+ * owner非空时表示这段内存属于一个共享缓冲区，解码结果可以保存指向其中的视图
+ */
+class BufferReader {
+public:
+    BufferReader(const char* data, size_t size, std::shared_ptr<const std::string> owner = nullptr)
+        : ptr_(data), end_(data + size), owner_(std::move(owner)) {}
+
+    bool readU8(uint8_t& value) {
+        if (remaining() < 1) {
+            return false;
+        }
+        value = static_cast<uint8_t>(*ptr_++);
+        return true;
+    }
+
+    bool readU32(uint32_t& value) {
+        if (remaining() < 4) {
+            return false;
+        }
+        const auto* bytes = reinterpret_cast<const unsigned char*>(ptr_);
+        value = static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+                (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+        ptr_ += 4;
+        return true;
+    }
+
+    bool readU64(uint64_t& value) {
+        uint32_t low = 0;
+        uint32_t high = 0;
+        if (!readU32(low) || !readU32(high)) {
+            return false;
+        }
+        value = (static_cast<uint64_t>(high) << 32) | low;
+        return true;
+    }
+
+    bool readI32(int& value) {
+        uint32_t raw = 0;
+        if (!readU32(raw)) {
+            return false;
+        }
+        value = static_cast<int>(raw);
+        return true;
+    }
+
+    bool readBool(bool& value) {
+        uint8_t raw = 0;
+        if (!readU8(raw)) {
+            return false;
+        }
+        value = raw != 0;
+        return true;
+    }
+
+    // 读取[长度(4)][内容]，返回指向输入内存的视图，不拷贝
+    bool readStringView(std::string_view& value) {
+        uint32_t size = 0;
+        if (!readU32(size) || remaining() < size) {
+            return false;
+        }
+        value = std::string_view(ptr_, size);
+        ptr_ += size;
+        return true;
+    }
+
+    // 读取[长度(4)][内容]并拷贝出来
+    bool readString(std::string& value) {
+        std::string_view view;
+        if (!readStringView(view)) {
+            return false;
+        }
+        value.assign(view.data(), view.size());
+        return true;
+    }
+
+    size_t remaining() const { return static_cast<size_t>(end_ - ptr_); }
+
+    const std::shared_ptr<const std::string>& owner() const { return owner_; }
+
+private:
+    const char* ptr_;
+    const char* end_;
+    std::shared_ptr<const std::string> owner_;
+};
+
+} // namespace raft
+
+#endif // CODEC_H
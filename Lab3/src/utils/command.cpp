@@ -0,0 +1,280 @@
+#include "command.h"
+#include "../include/constants.h"
+#include <cctype>
+#include <climits>
+#include <stdexcept>
+
+namespace raft {
+
+// 命令名比较，不区分大小写
+static bool equalsIgnoreCase(const std::string& name, const char* expected) {
+    size_t i = 0;
+    for (; i < name.size() && expected[i] != '\0'; ++i) {
+        if (std::toupper(static_cast<unsigned char>(name[i])) != expected[i]) {
+            return false;
+        }
+    }
+    return i == name.size() && expected[i] == '\0';
+}
+
+// 命令名转为大写，用于错误信息
+static std::string upperName(const std::string& name) {
+    std::string upper = name;
+    for (auto& c : upper) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return upper;
+}
+
+// 把MATCH模式转为前缀，只支持"prefix*"形式
+static bool patternPrefix(const std::string& pattern, std::string& prefix, std::string& error) {
+    if (pattern.empty() || pattern.back() != '*' ||
+        pattern.find_first_of("*?[\\") != pattern.size() - 1) {
+        error = "Only prefix patterns like 'prefix*' are supported";
+        return false;
+    }
+    prefix = pattern.substr(0, pattern.size() - 1);
+    return true;
+}
+
+// 十六进制字符的值，非法字符返回-1
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+std::string Command::encodeCursor(const std::string& last_key) {
+    static const char digits[] = "0123456789abcdef";
+    std::string cursor;
+    cursor.reserve(last_key.size() * 2);
+    for (unsigned char c : last_key) {
+        cursor.push_back(digits[c >> 4]);
+        cursor.push_back(digits[c & 0xf]);
+    }
+    return cursor;
+}
+
+// 解析SCAN游标，"0"表示从头开始
+static bool decodeCursor(const std::string& cursor, std::string& after) {
+    after.clear();
+    if (cursor == "0") {
+        return true;
+    }
+    if (cursor.empty() || cursor.size() % 2 != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < cursor.size(); i += 2) {
+        int high = hexValue(cursor[i]);
+        int low = hexValue(cursor[i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        after.push_back(static_cast<char>((high << 4) | low));
+    }
+    return true;
+}
+
+// 解析整数参数
+static bool parseInteger(const std::string& text, int64_t& value) {
+    try {
+        size_t used = 0;
+        long long parsed = std::stoll(text, &used);
+        if (used != text.size()) {
+            return false;
+        }
+        value = parsed;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// 相对时间换算为绝对过期时间(ms)，unit为1000（秒）或1（毫秒），溢出时返回false
+static bool absoluteExpireAt(int64_t amount, int64_t unit, int64_t now_ms, int64_t& expire_at) {
+    const int64_t max_ms = INT64_MAX / 2;
+    if (amount > max_ms / unit || amount < -max_ms / unit) {
+        return false;
+    }
+    expire_at = now_ms + amount * unit;
+    return true;
+}
+
+bool Command::fromArgs(const std::vector<std::string>& parsed, int64_t now_ms, Command& command, std::string& error) {
+    if (parsed.empty()) {
+        error = "Protocol error";
+        return false;
+    }
+    const std::string& name = parsed[0];
+    command.args.clear();
+
+    if (equalsIgnoreCase(name, "GET")) {
+        if (parsed.size() < 2) {
+            error = "Wrong number of arguments for GET command";
+            return false;
+        }
+        command.type = CommandType::GET;
+        command.args.push_back(parsed[1]);
+    } else if (equalsIgnoreCase(name, "SET")) {
+        if (parsed.size() < 3) {
+            error = "Wrong number of arguments for SET command";
+            return false;
+        }
+        // SET key value EX seconds | PX milliseconds
+        bool is_ex = parsed.size() == 5 && equalsIgnoreCase(parsed[3], "EX");
+        if (is_ex || (parsed.size() == 5 && equalsIgnoreCase(parsed[3], "PX"))) {
+            int64_t amount = 0;
+            int64_t expire_at = 0;
+            if (!parseInteger(parsed[4], amount) || amount <= 0 || !absoluteExpireAt(amount, is_ex ? 1000 : 1, now_ms, expire_at)) {
+                error = "Invalid expire time in SET";
+                return false;
+            }
+            command.type = CommandType::SET;
+            command.args = {parsed[1], parsed[2], std::to_string(expire_at)};
+            return true;
+        }
+        // 如果有多个参数，合并为一个值
+        std::string value = parsed[2];
+        for (size_t i = 3; i < parsed.size(); ++i) {
+            value += " " + parsed[i];
+        }
+        command.type = CommandType::SET;
+        command.args.push_back(parsed[1]);
+        command.args.push_back(std::move(value));
+    } else if (equalsIgnoreCase(name, "DEL") || equalsIgnoreCase(name, "MGET") || equalsIgnoreCase(name, "EXISTS")) {
+        // 以键列表为参数的命令
+        if (parsed.size() < 2) {
+            error = "Wrong number of arguments for " + upperName(name) + " command";
+            return false;
+        }
+        command.type = equalsIgnoreCase(name, "DEL") ? CommandType::DEL
+                     : equalsIgnoreCase(name, "MGET") ? CommandType::MGET : CommandType::EXISTS;
+        command.args.assign(parsed.begin() + 1, parsed.end());
+    } else if (equalsIgnoreCase(name, "MSET")) {
+        if (parsed.size() < 3 || parsed.size() % 2 == 0) {
+            error = "Wrong number of arguments for MSET command";
+            return false;
+        }
+        command.type = CommandType::MSET;
+        command.args.assign(parsed.begin() + 1, parsed.end());
+    } else if (equalsIgnoreCase(name, "SCAN")) {
+        // SCAN cursor [MATCH pattern] [COUNT count]
+        if (parsed.size() < 2 || parsed.size() % 2 != 0) {
+            error = "Wrong number of arguments for SCAN command";
+            return false;
+        }
+        std::string after;
+        if (!decodeCursor(parsed[1], after)) {
+            error = "Invalid cursor";
+            return false;
+        }
+        std::string prefix;
+        size_t count = SCAN_DEFAULT_COUNT;
+        for (size_t i = 2; i < parsed.size(); i += 2) {
+            if (equalsIgnoreCase(parsed[i], "MATCH")) {
+                if (!patternPrefix(parsed[i + 1], prefix, error)) {
+                    return false;
+                }
+            } else if (equalsIgnoreCase(parsed[i], "COUNT")) {
+                try {
+                    long long value = std::stoll(parsed[i + 1]);
+                    if (value <= 0) {
+                        throw std::invalid_argument("count");
+                    }
+                    count = static_cast<size_t>(value);
+                } catch (const std::exception&) {
+                    error = "COUNT must be a positive integer";
+                    return false;
+                }
+            } else {
+                error = "Syntax error";
+                return false;
+            }
+        }
+        command.type = CommandType::SCAN;
+        command.args = {std::move(after), std::move(prefix), std::to_string(count)};
+    } else if (equalsIgnoreCase(name, "KEYS")) {
+        if (parsed.size() != 2) {
+            error = "Wrong number of arguments for KEYS command";
+            return false;
+        }
+        std::string prefix;
+        if (!patternPrefix(parsed[1], prefix, error)) {
+            return false;
+        }
+        command.type = CommandType::KEYS;
+        command.args = {std::move(prefix)};
+    } else if (equalsIgnoreCase(name, "EXPIRE") || equalsIgnoreCase(name, "PEXPIRE")) {
+        if (parsed.size() != 3) {
+            error = "Wrong number of arguments for " + upperName(name) + " command";
+            return false;
+        }
+        int64_t amount = 0;
+        int64_t expire_at = 0;
+        bool seconds = equalsIgnoreCase(name, "EXPIRE");
+        if (!parseInteger(parsed[2], amount) || !absoluteExpireAt(amount, seconds ? 1000 : 1, now_ms, expire_at)) {
+            error = "Value is not an integer or out of range";
+            return false;
+        }
+        command.type = CommandType::EXPIRE;
+        command.args = {parsed[1], std::to_string(expire_at), std::to_string(now_ms)};
+    } else if (equalsIgnoreCase(name, "PERSIST")) {
+        if (parsed.size() != 2) {
+            error = "Wrong number of arguments for PERSIST command";
+            return false;
+        }
+        command.type = CommandType::PERSIST;
+        command.args = {parsed[1], std::to_string(now_ms)};
+    } else if (equalsIgnoreCase(name, "TTL") || equalsIgnoreCase(name, "PTTL")) {
+        if (parsed.size() != 2) {
+            error = "Wrong number of arguments for " + upperName(name) + " command";
+            return false;
+        }
+        command.type = equalsIgnoreCase(name, "TTL") ? CommandType::TTL : CommandType::PTTL;
+        command.args = {parsed[1]};
+    } else {
+        error = "Unknown command: " + name;
+        return false;
+    }
+    return true;
+}
+
+void Command::encode(std::string& out) const {
+    BufferWriter writer(out);
+    writer.writeU8(static_cast<uint8_t>(type));
+    writer.writeU32(static_cast<uint32_t>(args.size()));
+    for (const auto& arg : args) {
+        writer.writeString(arg);
+    }
+}
+
+bool Command::decode(BufferReader& reader) {
+    uint8_t raw_type = 0;
+    uint32_t count = 0;
+    if (!reader.readU8(raw_type) || !reader.readU32(count)) {
+        return false;
+    }
+    if (raw_type < static_cast<uint8_t>(CommandType::GET) || raw_type > static_cast<uint8_t>(CommandType::EVICT)) {
+        return false;
+    }
+    // 每个参数至少占4字节长度，参数个数不可能超过剩余字节数的1/4
+    if (count > reader.remaining() / 4) {
+        return false;
+    }
+    type = static_cast<CommandType>(raw_type);
+    args.resize(count);
+    for (auto& arg : args) {
+        std::string_view view;
+        if (!reader.readStringView(view)) {
+            return false;
+        }
+        arg.assign(view.data(), view.size());
+    }
+    return true;
+}
+
+} // namespace raft
@@ -0,0 +1,114 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "codec.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace raft {
+
+// 客户端命令的操作码
+enum class CommandType : uint8_t {
+    GET = 1,
+    SET = 2,
+    DEL = 3,
+    MSET = 4,
+    MGET = 5,
+    EXISTS = 6,
+    SCAN = 7,
+    KEYS = 8,
+    EXPIRE = 9,
+    PERSIST = 10,
+    TTL = 11,
+    PTTL = 12,
+    EXPIRED = 13,  // 内部命令：leader的过期时间轮删除到期的键，客户端不能发送
+    EVICT = 14,    // 内部命令：超过内存上限时leader淘汰选中的键，客户端不能发送
+};
+
+/**
+ * 客户端命令的结构化表示
+ * 请求在入口处解析一次并检查参数，以二进制形式[操作码(1)][参数个数(4)][参数长度(4)][参数]...写入日志，
+ * 复制时原样传输，应用时直接解码执行，不再解析RESP
+ */
+struct Command {
+    CommandType type = CommandType::GET;
+    std::vector<std::string> args;  // 命令参数，不含命令名；SET为[键, 值]或[键, 值, 过期时间]，MSET为键值交替排列，
+                                    // SCAN为[游标后的起始键, 前缀, 每页键数]，KEYS为[前缀]，
+                                    // EXPIRE为[键, 过期时间, 当前时间]，PERSIST/EXPIRED为[键, 当前时间]，其余（含EVICT）为键列表；
+                                    // 时间都是leader生成的绝对时间(ms)，应用日志时不读本地时钟，各副本结果一致
+
+    /**
+     * 由RESP解析出的参数列表（含命令名，命令名不区分大小写）构造命令
+     * SET的多个值参数以空格合并为一个值，只有SET key value EX|PX n的形式解析为带过期时间
+     * @param parsed 参数列表
+     * @param now_ms 当前时间(ms)，相对过期时间据此换算为绝对时间
+     * @param command 输出的命令
+     * @param error 失败时返回给客户端的错误信息
+     * @return 是否构造成功
+     */
+    static bool fromArgs(const std::vector<std::string>& parsed, int64_t now_ms, Command& command, std::string& error);
+
+    /**
+     * 编码追加到out末尾
+     */
+    void encode(std::string& out) const;
+
+    /**
+     * 从reader中解码一条命令，复用args已有的内存
+     * @return 格式错误时返回false
+     */
+    bool decode(BufferReader& reader);
+
+    // 只读命令，走ReadIndex读取，不写日志
+    bool isReadOnly() const {
+        return type == CommandType::GET || type == CommandType::MGET || type == CommandType::EXISTS ||
+               type == CommandType::SCAN || type == CommandType::KEYS ||
+               type == CommandType::TTL || type == CommandType::PTTL;
+    }
+
+    // 可能增加内存占用的命令，超过内存上限且不淘汰时拒绝
+    bool mayGrowMemory() const {
+        return type == CommandType::SET || type == CommandType::MSET;
+    }
+
+    // 遍历整个键空间的命令，不属于单个Raft组
+    bool isKeyspaceScan() const {
+        return type == CommandType::SCAN || type == CommandType::KEYS;
+    }
+
+    /**
+     * 由本页最后一个键生成SCAN返回给客户端的游标（十六进制编码，长度为偶数，不会与结束标记"0"混淆）
+     */
+    static std::string encodeCursor(const std::string& last_key);
+
+    // args中相邻两个键的间隔：SET/MSET的键后面跟着值
+    size_t keyStride() const {
+        return type == CommandType::SET || type == CommandType::MSET ? 2 : 1;
+    }
+
+    // args中键所在范围的结束位置：多键命令的参数都是键（或键值对），其余命令只有第一个参数是键
+    size_t keyEnd() const {
+        switch (type) {
+            case CommandType::MSET:
+            case CommandType::DEL:
+            case CommandType::MGET:
+            case CommandType::EXISTS:
+                return args.size();
+            case CommandType::SCAN:
+            case CommandType::KEYS:
+                return 0;
+            default:
+                return 1;
+        }
+    }
+
+    // 判断一段日志是否为二进制命令（旧版本日志中是RESP文本，以'*'开头）
+    static bool isEncoded(const std::string& entry) {
+        return !entry.empty() && entry[0] != '*';
+    }
+};
+
+} // namespace raft
+
+#endif // COMMAND_H
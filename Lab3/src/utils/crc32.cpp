@@ -0,0 +1,35 @@
+#include "crc32.h"
+
+namespace raft {
+
+namespace {
+
+// 生成查表用的CRC32表（反射多项式0xEDB88320）
+struct Crc32Table {
+    uint32_t table[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+    }
+};
+
+const Crc32Table kCrcTable;
+
+} // namespace
+
+uint32_t crc32(const void* data, size_t size, uint32_t crc) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = kCrcTable.table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+} // namespace raft
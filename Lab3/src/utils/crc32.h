@@ -0,0 +1,20 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace raft {
+
+/**
+ * 计算CRC32校验和（IEEE 802.3多项式）
+ * @param data 数据起始地址
+ * @param size 数据长度
+ * @param crc 上一段数据的校验和，用于分段计算
+ * @return 校验和
+ */
+uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+
+} // namespace raft
+
+#endif // CRC32_H
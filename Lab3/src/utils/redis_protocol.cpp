@@ -30,7 +30,7 @@ std::string RedisProtocol::encodeStatus(const std::string& status) {
     return "+" + status + "\r\n";
 }
 
-std::string RedisProtocol::encodeInteger(int value) {
+std::string RedisProtocol::encodeInteger(int64_t value) {
     return ":" + std::to_string(value) + "\r\n";
 }
 
@@ -121,13 +121,19 @@ bool RedisProtocol::tryParseJson(const std::string& content, nlohmann::json& res
 }
 
 std::vector<std::string> RedisProtocol::parseCommand(const std::string& command) {
+    size_t pos = 0;
+    return parseCommand(command, pos);
+}
+
+std::vector<std::string> RedisProtocol::parseCommand(const std::string& command, size_t& start) {
     std::vector<std::string> args;
     
-    if (command.empty() || command[0] != '*') {
+    size_t pos = start;
+    if (pos >= command.length() || command[pos] != '*') {
         return args;
     }
     
-    size_t pos = 1;
+    pos++;
     size_t endPos = command.find("\r\n", pos);
     if (endPos == std::string::npos) {
         return args;
@@ -145,33 +151,38 @@ std::vector<std::string> RedisProtocol::parseCommand(const std::string& command)
     for (int i = 0; i < argCount; ++i) {
         // 每个参数都应该以 $ 开头
         if (pos >= command.length() || command[pos] != '$') {
-            break;
+            args.clear();
+            return args;
         }
         
         // 获取参数长度
         endPos = command.find("\r\n", pos + 1);
         if (endPos == std::string::npos) {
-            break;
+            args.clear();
+            return args;
         }
         
         int argLength;
         try {
             argLength = std::stoi(command.substr(pos + 1, endPos - pos - 1));
         } catch (const std::exception&) {
-            break;
+            args.clear();
+            return args;
         }
         
         pos = endPos + 2;  // 跳过 \r\n
         
         // 获取参数内容
-        if (pos + argLength > command.length()) {
-            break;
+        if (argLength < 0 || pos + argLength > command.length()) {
+            args.clear();
+            return args;
         }
         
         args.push_back(command.substr(pos, argLength));
         pos += argLength + 2;  // 跳过参数内容和 \r\n
     }
     
+    start = std::min(pos, command.length());
     return args;
 }
 
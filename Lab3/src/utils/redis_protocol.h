@@ -1,6 +1,7 @@
 #ifndef REDIS_PROTOCOL_H
 #define REDIS_PROTOCOL_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <nlohmann/json.hpp>
@@ -51,7 +52,7 @@ public:
      * @param value 整数值
      * @return RESP格式的整数字符串
      */
-    static std::string encodeInteger(int value);
+    static std::string encodeInteger(int64_t value);
     
     /**
      * 编码数组为RESP格式
@@ -87,6 +88,14 @@ public:
      * @return 解析后的命令参数列表
      */
     static std::vector<std::string> parseCommand(const std::string& command);
+
+    /**
+     * 从指定位置解析一条RESP格式的命令，用于依次解析拼接在一起的多条命令
+     * @param data 包含一条或多条RESP命令的数据
+     * @param pos 起始位置，解析成功后移动到下一条命令的开头
+     * @return 解析后的命令参数列表，格式错误时返回空列表
+     */
+    static std::vector<std::string> parseCommand(const std::string& data, size_t& pos);
 };
 
 } // namespace raft
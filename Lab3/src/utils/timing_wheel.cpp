@@ -0,0 +1,85 @@
+#include "timing_wheel.h"
+
+namespace raft {
+
+TimingWheel::TimingWheel(int64_t tick_ms, int64_t now_ms)
+    : tick_ms_(tick_ms > 0 ? tick_ms : 1),
+      current_tick_(now_ms / tick_ms_) {}
+
+void TimingWheel::add(const std::string& key, int64_t deadline_ms) {
+    place(Entry{key, deadline_ms});
+    ++size_;
+}
+
+void TimingWheel::place(Entry entry) {
+    // 向上取整到tick，已到期的条目放到下一个tick
+    int64_t tick = (entry.deadline_ms + tick_ms_ - 1) / tick_ms_;
+    if (tick <= current_tick_) {
+        tick = current_tick_ + 1;
+    }
+    int64_t delta = tick - current_tick_;
+
+    // 找到能容纳该距离的最低层
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (int64_t(1) << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    if (delta >= (int64_t(1) << (SLOT_BITS * LEVELS))) {
+        // 超出最高层范围，先放在最高层最远的格子，转到时再重新计算
+        tick = current_tick_ + (int64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+    }
+    size_t slot = static_cast<size_t>((tick >> (SLOT_BITS * level)) & SLOT_MASK);
+    slots_[level][slot].push_back(std::move(entry));
+}
+
+void TimingWheel::advance(int64_t now_ms, const ExpireCallback& on_expire) {
+    int64_t target = now_ms / tick_ms_;
+    if (size_ == 0) {
+        // 没有条目时直接跳到目标时间
+        if (target > current_tick_) {
+            current_tick_ = target;
+        }
+        return;
+    }
+
+    while (current_tick_ < target) {
+        ++current_tick_;
+
+        // 低层转完一圈时，把上一层对应格子的条目重新分配到低层
+        for (int level = 1; level < LEVELS; ++level) {
+            if ((current_tick_ & ((int64_t(1) << (SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            size_t slot = static_cast<size_t>((current_tick_ >> (SLOT_BITS * level)) & SLOT_MASK);
+            std::vector<Entry> entries;
+            entries.swap(slots_[level][slot]);
+            for (auto& entry : entries) {
+                place(std::move(entry));
+            }
+        }
+
+        // 第0层当前格中的条目到期
+        std::vector<Entry> expired;
+        expired.swap(slots_[0][static_cast<size_t>(current_tick_ & SLOT_MASK)]);
+        size_ -= expired.size();
+        for (const auto& entry : expired) {
+            on_expire(entry.key, entry.deadline_ms);
+        }
+        if (size_ == 0) {
+            current_tick_ = target;
+            break;
+        }
+    }
+}
+
+void TimingWheel::clear(int64_t now_ms) {
+    for (auto& level : slots_) {
+        for (auto& slot : level) {
+            slot.clear();
+        }
+    }
+    size_ = 0;
+    current_tick_ = now_ms / tick_ms_;
+}
+
+} // namespace raft
@@ -0,0 +1,65 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace raft {
+
+/**
+ * 分层时间轮，用于键的过期
+ * 第0层每格一个tick，之后每层的一格覆盖下一层的一整圈；条目按到期tick放入对应层的格子，
+ * 时间推进到高层格子时把其中的条目重新分配到低层，第0层的格子转到时条目到期。
+ * 添加为O(1)，每个条目到期前最多被下移LEVELS-1次，不需要扫描全部条目。
+ * 超出最高层范围的条目暂放在最高层，转到时重新计算位置。
+ * 非线程安全，由调用者加锁
+ */
+class TimingWheel {
+public:
+    // 到期回调：键和添加时的到期时间(ms)
+    using ExpireCallback = std::function<void(const std::string& key, int64_t deadline_ms)>;
+
+    /**
+     * @param tick_ms 每格的时间跨度(ms)
+     * @param now_ms 当前时间(ms)
+     */
+    TimingWheel(int64_t tick_ms, int64_t now_ms);
+
+    // 添加一个条目，已经到期的条目在下一个tick到期
+    void add(const std::string& key, int64_t deadline_ms);
+
+    // 推进到now_ms，把到期的条目交给回调
+    void advance(int64_t now_ms, const ExpireCallback& on_expire);
+
+    // 清空所有条目，从now_ms重新开始计时
+    void clear(int64_t now_ms);
+
+    // 条目数
+    size_t size() const { return size_; }
+
+private:
+    static constexpr int LEVELS = 4;                   // 层数
+    static constexpr int SLOT_BITS = 6;                // 每层格数的位数
+    static constexpr int SLOTS = 1 << SLOT_BITS;       // 每层格数
+    static constexpr int64_t SLOT_MASK = SLOTS - 1;
+
+    struct Entry {
+        std::string key;
+        int64_t deadline_ms;
+    };
+
+    // 按到期tick把条目放入对应层的格子
+    void place(Entry entry);
+
+    int64_t tick_ms_;         // 每格的时间跨度(ms)
+    int64_t current_tick_;    // 已处理到的tick
+    size_t size_ = 0;         // 条目数
+    std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> slots_;
+};
+
+} // namespace raft
+
+#endif // TIMING_WHEEL_H
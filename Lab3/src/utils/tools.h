@@ -3,6 +3,8 @@
 
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <cstdint>
 
 namespace raft {
 
@@ -37,6 +39,14 @@ inline void log(LogLevel level, const std::string& message) {
     }
 }
 
+/**
+ * 当前的Unix时间(ms)，用于键的过期时间；过期时间以绝对时间写入日志，各副本看到同一个值
+ */
+inline int64_t currentTimeMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 } // namespace raft
 
 #endif // TOOLS_H 
\ No newline at end of file